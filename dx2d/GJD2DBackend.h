@@ -0,0 +1,333 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iostream>
+#include <string>
+
+#include <windows.h>
+#include <d2d1.h>
+#include <d2d1helper.h>
+#include <dwrite.h>
+#include <wrl/client.h>
+#include <wincodec.h>
+
+#include "danny/cppUtil.h"
+#include "GJRenderBackend.h"
+
+using Microsoft::WRL::ComPtr;
+
+/// RenderBackend of the game window: Direct2D targets, WIC decoding and DirectWrite text. Failures show a message box and
+/// exit.
+class D2DBackend final : public RenderBackend {
+public:
+    explicit D2DBackend(HWND hWnd)
+        : hWnd(hWnd) {
+        // Create WIC Factory
+        HRESULT hr =
+            CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(pWICFactory.GetAddressOf()));
+        checkFailed(hr, "CoCreateInstance failed");
+
+        hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, pFactory.GetAddressOf());
+        checkFailed(hr, "CreateFactory");
+
+        // Get the size of the client area
+        RECT clientRect; //< actual window size
+        GetClientRect(hWnd, &clientRect);
+        ASSERT_EXPR(clientRect.left == 0, "API promises this, but we do a sanity check");
+        ASSERT_EXPR(clientRect.top == 0);
+
+        hr = pFactory->CreateHwndRenderTarget(D2D1::RenderTargetProperties(),
+                                              D2D1::HwndRenderTargetProperties(hWnd,
+                                                                               D2D1::SizeU(clientRect.right,
+                                                                                           clientRect.bottom)),
+                                              pRenderTarget.GetAddressOf());
+        checkFailed(hr, "createHwndRenderTarget failed");
+
+        // Square low res target, upscaled to fit the window
+        constexpr int UPSCALE_FACTOR = 2;
+        width                        = uint32_t(std::min(clientRect.right, clientRect.bottom) / UPSCALE_FACTOR);
+        height                       = width;
+
+        // Create a compatible render target for low-res drawing
+        hr = pRenderTarget->CreateCompatibleRenderTarget(D2D1::SizeF(toF(width), toF(height)),
+                                                         pLowResRenderTarget.GetAddressOf());
+        checkFailed(hr, "createCompatibleRenderTarget failed");
+
+        // Disable anti-aliasing for pixelated look
+        pLowResRenderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+        pRenderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+
+        // Target of drawPixels, uploaded to every frame
+        hr = pLowResRenderTarget->CreateBitmap(D2D1::SizeU(width, height), nullptr, 0, &PIXELS_PROPERTIES, &pPixelsBitmap);
+        checkFailed(hr, "createBitmap failed");
+
+        // Solid color brush, recolored per draw call
+        hr = pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF(0.1f, 0.1f, 0.1f)), &brush);
+        checkFailed(hr, "createSolidColorBrush failed");
+
+        createTextFormats();
+    }
+
+    uint32_t getWidth() const override { return width; }
+    uint32_t getHeight() const override { return height; }
+
+    void beginFrame() override {
+        pRenderTarget->BeginDraw();
+        pLowResRenderTarget->BeginDraw();
+
+        pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::Black));
+        pLowResRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::Black, 0.f));
+    }
+
+    void endFrame() override {
+        // draw low res rt to main rt
+        pLowResRenderTarget->EndDraw();
+
+        ID2D1Bitmap* pLowResBitmap = nullptr;
+        HRESULT      hr            = pLowResRenderTarget->GetBitmap(&pLowResBitmap);
+        checkFailed(hr, "getBitmap failed");
+
+        // letterboxing:
+
+        RECT clientRect; //< actual window size
+        GetClientRect(hWnd, &clientRect);
+        ASSERT_EXPR(clientRect.top == 0 && clientRect.left == 0, "API promises this, but let's sanity check");
+        int clientW = clientRect.right;
+        int clientH = clientRect.bottom;
+
+        int squareSize = std::min(clientW, clientH);
+        int offsetX    = (clientW - squareSize) / 2;
+        int offsetY    = (clientH - squareSize) / 2;
+
+        D2D1_RECT_F destRect =
+            D2D1::RectF(float(offsetX), float(offsetY), float(offsetX + squareSize), float(offsetY + squareSize));
+
+        pRenderTarget->DrawBitmap(pLowResBitmap,                                   // The bitmap to draw
+                                  &destRect,                                       // Destination rectangle
+                                  1.0f,                                            // Opacity (1.0f = fully opaque)
+                                  D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, // Nearest-neighbor for pixelated scaling
+                                  NULL // Source rectangle (NULL to use the entire bitmap)
+        );
+        pLowResBitmap->Release();
+        hr = pRenderTarget->EndDraw();
+        // an occluded (e.g. minimized) window is not presented to, so EndDraw returns without waiting
+        vsyncPresented = !(pRenderTarget->CheckWindowState() & D2D1_WINDOW_STATE_OCCLUDED);
+
+        if (hr == D2DERR_RECREATE_TARGET) {
+            assert(false); // this case has not been tested / implemented yet
+            throw std::runtime_error("D2DERR_RECREATE_TARGET");
+        }
+    }
+
+    bool presentWaitedForVsync() const override { return vsyncPresented; }
+
+    void resize() override {
+        RECT rc;
+        GetClientRect(hWnd, &rc);
+        pRenderTarget->Resize(D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top));
+    }
+
+    void fillRectangle(const RectF& rect, ColorF color, DrawTarget target) override {
+        getTarget(target)->FillRectangle(toD2D(rect), getBrush(color));
+    }
+
+    void drawLine(float x0, float y0, float x1, float y1, ColorF color, float strokeWidth) override {
+        pLowResRenderTarget->DrawLine(D2D1_POINT_2F(x0, y0), D2D1_POINT_2F(x1, y1), getBrush(color), strokeWidth);
+    }
+
+    void drawText(std::wstring_view text, TextFormat format, const RectF& layout, ColorF color, DrawTarget target) override {
+        getTarget(target)->DrawText(text.data(),
+                                    toU32(text.size()),
+                                    textFormats[static_cast<size_t>(format)].Get(),
+                                    toD2D(layout),
+                                    getBrush(color));
+    }
+
+    CPUBitmap decodeImage(const std::filesystem::path& path) override {
+        ComPtr<IWICFormatConverter> converter = decode(path, GUID_WICPixelFormat32bppBGRA, WICDecodeMetadataCacheOnDemand);
+
+        UINT imageWidth, imageHeight;
+        converter->GetSize(&imageWidth, &imageHeight);
+
+        // Allocate memory for pixel data
+        CPUBitmap bitmap = { .width = imageWidth, .height = imageHeight, .channels = 4 };
+        bitmap.data.resize(imageWidth * imageHeight * 4);
+
+        // Copy pixels to the vector
+        HRESULT hr = converter->CopyPixels(nullptr, imageWidth * 4, static_cast<UINT>(bitmap.data.size()), bitmap.data.data());
+        checkFailed(hr, "failed to copy pixels");
+        return bitmap;
+    }
+
+    void loadImage(EGPUBitmap image, const std::filesystem::path& path) override {
+        // Direct2D expects BGRA format with premultiplied alpha
+        ComPtr<IWICFormatConverter> converter = decode(path, GUID_WICPixelFormat32bppPBGRA, WICDecodeMetadataCacheOnLoad);
+
+        HRESULT hr = pRenderTarget->CreateBitmapFromWicBitmap(converter.Get(),
+                                                              nullptr, // Bitmap properties; nullptr for default
+                                                              &images[static_cast<size_t>(image)]);
+        checkFailed(hr, "createBitmapFromWicBitmap failed");
+    }
+
+    void createImage(EGPUBitmap image, uint32_t imageWidth, uint32_t imageHeight) override {
+        HRESULT hr = pLowResRenderTarget->CreateBitmap(D2D1::SizeU(imageWidth, imageHeight),
+                                                       nullptr,
+                                                       0,
+                                                       &PIXELS_PROPERTIES,
+                                                       &images[static_cast<size_t>(image)]);
+        checkFailed(hr, "createBitmap failed");
+    }
+
+    void updateImage(EGPUBitmap image, const uint32_t* pixels, uint32_t top, uint32_t bottom) override {
+        ID2D1Bitmap*      bitmap     = images[static_cast<size_t>(image)].Get();
+        const uint32_t    imageWidth = bitmap->GetPixelSize().width;
+        const D2D1_RECT_U destRect   = { 0U, top, imageWidth, bottom };
+        bitmap->CopyFromMemory(&destRect, pixels + size_t(top) * imageWidth, imageWidth * sizeof(uint32_t));
+    }
+
+    SizeF getImageSize(EGPUBitmap image) const override {
+        const D2D1_SIZE_F size = images[static_cast<size_t>(image)]->GetSize();
+        return { size.width, size.height };
+    }
+
+    void drawImage(EGPUBitmap image, const RectF& dest) override {
+        pLowResRenderTarget->DrawBitmap(images[static_cast<size_t>(image)].Get(),
+                                        toD2D(dest),
+                                        1.0f, // Opacity (1.0f = fully opaque)
+                                        D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
+                                        nullptr // Source rectangle (nullptr to use entire bitmap)
+        );
+    }
+
+    void drawPixels(const uint32_t* pixels, uint32_t pixelsWidth, uint32_t pixelsHeight, const RectF& dest) override {
+        // one upload, into the top left of the full size bitmap:
+        D2D1_RECT_U destRect = { 0U, 0U, pixelsWidth, pixelsHeight };
+        pPixelsBitmap->CopyFromMemory(&destRect, pixels, pixelsWidth * sizeof(uint32_t));
+
+        D2D1_RECT_F sourceRect = D2D1::RectF(0.f, 0.f, float(pixelsWidth), float(pixelsHeight));
+        pLowResRenderTarget->DrawBitmap(pPixelsBitmap.Get(),
+                                        toD2D(dest),
+                                        1.0f, // Opacity (1.0f = fully opaque)
+                                        D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
+                                        &sourceRect);
+    }
+
+private:
+    /// Of the bitmaps filled from memory: drawPixels and createImage
+    static constexpr D2D1_BITMAP_PROPERTIES PIXELS_PROPERTIES = {
+        { DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED }, // BGRA format required for Direct2D
+        96.0f,
+        96.0f // DPI
+    };
+
+    static D2D1_RECT_F toD2D(const RectF& rect) { return D2D1::RectF(rect.left, rect.top, rect.right, rect.bottom); }
+
+    ID2D1RenderTarget* getTarget(DrawTarget target) const {
+        return target == DrawTarget::Window ? static_cast<ID2D1RenderTarget*>(pRenderTarget.Get()) : pLowResRenderTarget.Get();
+    }
+
+    ID2D1SolidColorBrush* getBrush(ColorF color) {
+        brush->SetColor(D2D1::ColorF(color.r, color.g, color.b, color.a));
+        return brush.Get();
+    }
+
+    /// \return the first frame of an image file, converted to `format`
+    ComPtr<IWICFormatConverter> decode(const std::filesystem::path& path,
+                                       REFWICPixelFormatGUID        format,
+                                       WICDecodeOptions             options) {
+        ComPtr<IWICBitmapDecoder> decoder;
+        HRESULT hr = pWICFactory->CreateDecoderFromFilename(path.c_str(), nullptr, GENERIC_READ, options, &decoder);
+        checkFailed(hr, "Failed to load image " + path.string());
+
+        // Get the first frame of the image
+        ComPtr<IWICBitmapFrameDecode> frame;
+        hr = decoder->GetFrame(0, &frame);
+        checkFailed(hr, "failed to get image frame");
+
+        ComPtr<IWICFormatConverter> converter;
+        hr = pWICFactory->CreateFormatConverter(&converter);
+        checkFailed(hr, "failed to create format converter\n");
+
+        hr = converter->Initialize(frame.Get(), format, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+        checkFailed(hr, "failed to init format converter");
+        return converter;
+    }
+
+    void createTextFormats() {
+        IDWriteFactory* pDWriteFactory = nullptr;
+        HRESULT         hr             = DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED,
+                                         __uuidof(IDWriteFactory),
+                                         reinterpret_cast<IUnknown**>(&pDWriteFactory));
+        checkFailed(hr, "DWriteCreateFactory failed");
+
+        ComPtr<IDWriteFontCollection> pFontCollection;
+        hr = pDWriteFactory->GetSystemFontCollection(&pFontCollection, FALSE);
+        checkFailed(hr, "getSystemFontCollection failed");
+
+        // Find the font family by name
+        UINT32 index  = 0;
+        BOOL   exists = FALSE;
+        hr            = pFontCollection->FindFamilyName(fontName.c_str(), &index, &exists);
+        if (FAILED(hr) || !exists) {
+            MessageBox(NULL,
+                       L"Please, exit the game, install the 'pressStart2P.ttf font file in the game folder for the game to "
+                       L"render text properly",
+                       L"Error",
+                       MB_OK);
+            std::wcerr << L"FindFamilyName failed: " << hr << std::endl;
+        }
+
+        static_assert(static_cast<size_t>(TextFormat::size) == 3, "update text formats");
+        struct Desc {
+            float                     size;
+            DWRITE_TEXT_ALIGNMENT     alignment;
+            DWRITE_PARAGRAPH_ALIGNMENT paragraphAlignment;
+        };
+        constexpr std::array<Desc, static_cast<size_t>(TextFormat::size)> DESCS = { {
+            { 30.f, DWRITE_TEXT_ALIGNMENT_CENTER, DWRITE_PARAGRAPH_ALIGNMENT_NEAR },   // HEADING
+            { 16.f, DWRITE_TEXT_ALIGNMENT_CENTER, DWRITE_PARAGRAPH_ALIGNMENT_NEAR },   // NORMAL
+            { 12.f, DWRITE_TEXT_ALIGNMENT_TRAILING, DWRITE_PARAGRAPH_ALIGNMENT_NEAR }, // SMALL
+        } };
+        for (size_t i = 0; i < DESCS.size(); ++i) {
+            hr = pDWriteFactory->CreateTextFormat(fontName.c_str(), // Font family
+                                                  nullptr,          // Font collection
+                                                  DWRITE_FONT_WEIGHT_NORMAL,
+                                                  DWRITE_FONT_STYLE_NORMAL,
+                                                  DWRITE_FONT_STRETCH_NORMAL,
+                                                  DESCS[i].size,
+                                                  L"", // Locale
+                                                  &textFormats[i]);
+            checkFailed(hr, "createTextFormat failed");
+            textFormats[i]->SetTextAlignment(DESCS[i].alignment);
+            textFormats[i]->SetParagraphAlignment(DESCS[i].paragraphAlignment);
+        }
+        pDWriteFactory->Release();
+    }
+
+    void checkFailed(HRESULT hr, const std::string& message) {
+        assert(!FAILED(hr)); // break into debugger
+        if (FAILED(hr)) {
+            MessageBoxA(NULL, message.c_str(), "Error", MB_OK);
+            DestroyWindow(hWnd);
+            CoUninitialize();
+            exit(-1);
+        }
+    }
+
+    HWND     hWnd;
+    uint32_t width          = 0;     //< of the low res target
+    uint32_t height         = 0;
+    bool     vsyncPresented = false; //< see presentWaitedForVsync
+
+    std::wstring                    fontName            = L"Press Start 2P";
+    ComPtr<ID2D1Factory>            pFactory            = nullptr;
+    ComPtr<IWICImagingFactory>      pWICFactory         = nullptr;
+    ComPtr<ID2D1HwndRenderTarget>   pRenderTarget       = nullptr;
+    ComPtr<ID2D1BitmapRenderTarget> pLowResRenderTarget = nullptr;
+    ComPtr<ID2D1SolidColorBrush>    brush               = nullptr;
+    ComPtr<ID2D1Bitmap>             pPixelsBitmap       = nullptr; //< see drawPixels
+
+    std::array<ComPtr<ID2D1Bitmap>, static_cast<size_t>(EGPUBitmap::size)>        images;
+    std::array<ComPtr<IDWriteTextFormat>, static_cast<size_t>(TextFormat::size)> textFormats;
+};
@@ -0,0 +1,397 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "GJRaster.h"
+#include "GJSimd.h"
+#include "GJTexture.h"
+
+// Floor casting into the renderer's drawBuffer. Free of DirectX / Windows dependencies so the kernels can be checked
+// against each other and benchmarked on any platform.
+
+/// What the floor pass needs to know about the camera.
+struct FloorView {
+    float   camX;
+    float   camY;
+    float   dirAngle;   //< radians
+    float   camHeight;  //< world units above the floor
+    float   screenDist; //< pixels from the eye to the screen, vertically
+    float   horTan;     //< tan(fov / 2): half the floor width seen per unit of distance
+    int32_t horizon;    //< row of the horizon, may lie outside the frame. See GJRenderer::getHorizon
+};
+
+/// First floor row below the horizon, clamped to the frame
+template <typename Pixel>
+int32_t getFloorBegin(const BasicFrameView<Pixel>& frame, const FloorView& view) {
+    return std::clamp<int32_t>(view.horizon + 1, 0, int32_t(frame.height) - 1);
+}
+
+/// Reference kernel: per row an atan2 and a tan, per pixel an atan2, a cos, a sin, a cos and a divide. Kept to check and
+/// benchmark castFloor against.
+/// \param sample (float worldX, float worldY) -> BGRA texel
+template <typename Sampler>
+void castFloorReference(const FrameView& frame, const FloorView& view, Sampler&& sample) {
+    const float halfWidth = float(frame.width) / 2.f;
+    for (int32_t y = getFloorBegin(frame, view); y < int32_t(frame.height); ++y) {
+        float zAngle = std::atan2(view.screenDist, float(y - view.horizon - 1)); // hor.angle of vision for pix y.
+        float y_d    = view.camHeight * std::tan(zAngle); // distance along y-plane that scanline meets floor-plane
+
+        // v   opposite = tan(a) * adj
+        float     horWidth = view.horTan * y_d; //< half horizontal width seen in this scanline
+        uint32_t* row      = frame.row(uint32_t(y));
+        for (uint32_t x = 0; x < frame.width; ++x) {
+            float x_t         = (float(x) - halfWidth) / halfWidth; // -1 (left) to 1 (right)
+            float screenAngle = std::atan2(horWidth * x_t, y_d);    //< hor.angle of vision for pix x.
+            float angle       = view.dirAngle + screenAngle;
+
+            // v   hyp		   = adj / cos(a)
+            float perspCorrect = y_d / std::cos(screenAngle);
+
+            row[x] = sample(view.camX + std::cos(angle) * perspCorrect, view.camY + std::sin(angle) * perspCorrect);
+        }
+    }
+}
+
+/// World position under the leftmost pixel of a floor row, and the step between two pixels of the row.
+struct FloorRow {
+    float x;
+    float y;
+    float stepX;
+    float stepY;
+    float distance; //< along the view direction
+};
+
+/// The distance at which a row sees a horizontal plane is the plane's height above (or below) the eye times this.
+/// \param rowsFromHorizon 0 for the rows right above and below the horizon
+inline float getRowScale(const FloorView& view, int32_t rowsFromHorizon) {
+    // those rows would see the plane at infinity: sample them half a pixel further from the horizon
+    return view.screenDist / std::max(float(rowsFromHorizon), 0.5f);
+}
+
+/// The points of a horizontal plane seen by one row lie on a line perpendicular to the view direction, at `distance`
+/// in front of the camera and spanning +-horTan * distance. Every pixel of the row is then a linear step from the
+/// leftmost one.
+/// \param dirX, dirY cos and sin of view.dirAngle
+inline FloorRow getPlaneRow(const FloorView& view, uint32_t width, float distance, float dirX, float dirY) {
+    // right of the screen is +90deg from the view direction
+    const float halfWidth = view.horTan * distance;
+    const float rightX    = -dirY * halfWidth;
+    const float rightY    = dirX * halfWidth;
+    const float perPixel  = 2.f / float(width);
+    return { view.camX + dirX * distance - rightX,
+             view.camY + dirY * distance - rightY,
+             rightX * perPixel,
+             rightY * perPixel,
+             distance };
+}
+
+inline FloorRow getFloorRow(const FloorView& view, uint32_t width, int32_t y, float dirX, float dirY) {
+    return getPlaneRow(view, width, view.camHeight * getRowScale(view, y - view.horizon - 1), dirX, dirY);
+}
+
+/// Per row one divide, per pixel two adds.
+/// \param sample (float worldX, float worldY) -> pixel
+/// \param band rows to draw, see ALL_ROWS
+/// \param columns to draw, see ColumnSet
+template <typename Pixel, typename Sampler>
+void castFloor(const BasicFrameView<Pixel>& frame,
+               const FloorView&             view,
+               Sampler&&                    sample,
+               SpanRows                     band    = ALL_ROWS,
+               ColumnSet                    columns = ALL_COLUMNS) {
+    const float   dirX = std::cos(view.dirAngle);
+    const float   dirY = std::sin(view.dirAngle);
+    const int32_t end  = std::min(int32_t(frame.height), band.end);
+    for (int32_t y = std::max(getFloorBegin(frame, view), band.begin); y < end; ++y) {
+        const FloorRow r      = getFloorRow(view, frame.width, y, dirX, dirY);
+        Pixel*         row    = frame.row(uint32_t(y));
+        float          worldX = r.x + float(columns.first) * r.stepX;
+        float          worldY = r.y + float(columns.first) * r.stepY;
+        const float    stepX  = r.stepX * float(columns.step);
+        const float    stepY  = r.stepY * float(columns.step);
+        for (uint32_t x = columns.first; x < frame.width; x += columns.step, worldX += stepX, worldY += stepY) {
+            row[x] = sample(worldX, worldY);
+        }
+    }
+}
+
+/// One mip level of a RowMajor, power-of-two texture that repeats once per world unit.
+/// \tparam Texel uint32_t for BGRA textures, uint8_t for palette indexed ones
+template <typename Texel>
+struct BasicFloorTexture {
+    const Texel* texels;
+    uint32_t     width; //< power of two
+    uint32_t     widthMask;
+    uint32_t     heightMask;
+
+    /// \param level of `texture`, which must be RowMajor with power-of-two sides
+    static BasicFloorTexture fromMip(const CPUBitmap& texture, size_t level) {
+        const MipLevel mip = texture.getMip(level);
+        const Texel*   texels;
+        if constexpr (sizeof(Texel) == 1) {
+            texels = texture.indices(level);
+        } else {
+            texels = texture.texels(level);
+        }
+        return { texels, uint32_t(mip.width), uint32_t(mip.width - 1), uint32_t(mip.height - 1) };
+    }
+
+    Texel sample(float worldX, float worldY) const {
+        // floor, not truncation, so negative coordinates wrap the same way as positive ones
+        const uint32_t u = uint32_t(int32_t(std::floor(worldX * float(width)))) & widthMask;
+        const uint32_t v = uint32_t(int32_t(std::floor(worldY * float(heightMask + 1)))) & heightMask;
+        return texels[v * width + u];
+    }
+};
+
+using FloorTexture        = BasicFloorTexture<uint32_t>;
+using IndexedFloorTexture = BasicFloorTexture<uint8_t>;
+
+/// Pixels [begin, end) of a floor row. Pixel i samples r.x + i * r.stepX, not a running sum, so every path computes
+/// the same coordinates.
+template <typename Texel>
+void sampleFloorRowScalar(Texel* row, uint32_t begin, uint32_t end, const FloorRow& r, const BasicFloorTexture<Texel>& tex) {
+    for (uint32_t i = begin; i < end; ++i) {
+        row[i] = tex.sample(r.x + float(i) * r.stepX, r.y + float(i) * r.stepY);
+    }
+}
+
+#if GJ_SIMD_X86
+
+/// \return number of pixels written. The remaining (count % 8) are left to the caller
+GJ_TARGET_AVX2 GJ_NO_FP_CONTRACT inline uint32_t sampleFloorRowAVX2(uint32_t*           row,
+                                                                    uint32_t            count,
+                                                                    const FloorRow&     r,
+                                                                    const FloorTexture& tex) {
+    const __m256  lanes      = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+    const __m256  startX     = _mm256_set1_ps(r.x);
+    const __m256  startY     = _mm256_set1_ps(r.y);
+    const __m256  stepX      = _mm256_set1_ps(r.stepX);
+    const __m256  stepY      = _mm256_set1_ps(r.stepY);
+    const __m256  texWidth   = _mm256_set1_ps(float(tex.width));
+    const __m256  texHeight  = _mm256_set1_ps(float(tex.heightMask + 1));
+    const __m256i widthMask  = _mm256_set1_epi32(int32_t(tex.widthMask));
+    const __m256i heightMask = _mm256_set1_epi32(int32_t(tex.heightMask));
+    const int     rowShift   = int(std::log2(float(tex.width)) + 0.5f);
+    const int*    texels     = reinterpret_cast<const int*>(tex.texels);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // mul + add, kept apart by GJ_NO_FP_CONTRACT: the same rounding as sampleFloorRowScalar
+        const __m256 index  = _mm256_add_ps(_mm256_set1_ps(float(i)), lanes);
+        const __m256 worldX = _mm256_add_ps(startX, _mm256_mul_ps(index, stepX));
+        const __m256 worldY = _mm256_add_ps(startY, _mm256_mul_ps(index, stepY));
+
+        const __m256i u = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(worldX, texWidth))), widthMask);
+        const __m256i v = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(worldY, texHeight))), heightMask);
+
+        const __m256i texelIndex = _mm256_add_epi32(_mm256_slli_epi32(v, rowShift), u);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + i), _mm256_i32gather_epi32(texels, texelIndex, 4));
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+/// Like the BGRA kernel, but gathers 32 bits at the byte offset of each index, which is why indexed textures carry 3
+/// bytes of padding, see Palette::quantize
+GJ_TARGET_AVX2 GJ_NO_FP_CONTRACT inline uint32_t sampleFloorRowAVX2(uint8_t*                   row,
+                                                                    uint32_t                   count,
+                                                                    const FloorRow&            r,
+                                                                    const IndexedFloorTexture& tex) {
+    const __m256  lanes      = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+    const __m256  startX     = _mm256_set1_ps(r.x);
+    const __m256  startY     = _mm256_set1_ps(r.y);
+    const __m256  stepX      = _mm256_set1_ps(r.stepX);
+    const __m256  stepY      = _mm256_set1_ps(r.stepY);
+    const __m256  texWidth   = _mm256_set1_ps(float(tex.width));
+    const __m256  texHeight  = _mm256_set1_ps(float(tex.heightMask + 1));
+    const __m256i widthMask  = _mm256_set1_epi32(int32_t(tex.widthMask));
+    const __m256i heightMask = _mm256_set1_epi32(int32_t(tex.heightMask));
+    const __m256i byteMask   = _mm256_set1_epi32(0xFF);
+    const __m256i lowDwords  = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0); //< the packed bytes of both 128 bit lanes
+    const int     rowShift   = int(std::log2(float(tex.width)) + 0.5f);
+    const int*    texels     = reinterpret_cast<const int*>(tex.texels);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 index  = _mm256_add_ps(_mm256_set1_ps(float(i)), lanes);
+        const __m256 worldX = _mm256_add_ps(startX, _mm256_mul_ps(index, stepX));
+        const __m256 worldY = _mm256_add_ps(startY, _mm256_mul_ps(index, stepY));
+
+        const __m256i u = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(worldX, texWidth))), widthMask);
+        const __m256i v = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(worldY, texHeight))), heightMask);
+
+        const __m256i texelIndex = _mm256_add_epi32(_mm256_slli_epi32(v, rowShift), u);
+        const __m256i gathered   = _mm256_and_si256(_mm256_i32gather_epi32(texels, texelIndex, 1), byteMask);
+        const __m256i words      = _mm256_packus_epi32(gathered, gathered);
+        const __m256i bytes      = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(words, words), lowDwords);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(row + i), _mm256_castsi256_si128(bytes));
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+#endif // GJ_SIMD_X86
+
+/// Texel footprint of a row at level 0, along or across the row, whichever is larger.
+/// \param nextDistance distance of the next row away from the horizon
+inline float getRowFootprint(const FloorRow& r, float nextDistance, size_t textureWidth) {
+    const float alongRow   = std::sqrt(r.stepX * r.stepX + r.stepY * r.stepY);
+    const float acrossRows = std::abs(r.distance - nextDistance);
+    return std::max(alongRow, acrossRows) * float(textureWidth);
+}
+
+/// \param texture RowMajor, power-of-two sides, see FloorTexture. Palette indexed for uint8_t rows
+/// \param columns of the row to draw. A sparse set is a row of its own with a longer step, sampled into a small packed
+/// buffer and scattered from there, so it keeps the SIMD path
+template <typename Pixel>
+void drawFloorRow(Pixel*           row,
+                  uint32_t         width,
+                  const FloorRow&  r,
+                  float            nextDistance,
+                  const CPUBitmap& texture,
+                  SimdLevel        simdLevel,
+                  ColumnSet        columns = ALL_COLUMNS) {
+    // the mip follows the footprint of a screen pixel, drawn or not
+    const size_t                   level  = texture.selectMip(getRowFootprint(r, nextDistance, texture.width));
+    const BasicFloorTexture<Pixel> tex    = BasicFloorTexture<Pixel>::fromMip(texture, level);
+    auto                           sample = [&tex, simdLevel](Pixel* out, uint32_t count, const FloorRow& from) {
+        uint32_t done = 0;
+#if GJ_SIMD_X86
+        if (simdLevel == SimdLevel::AVX2) {
+            done = sampleFloorRowAVX2(out, count, from, tex);
+        }
+#endif
+        sampleFloorRowScalar(out, done, count, from, tex);
+    };
+    if (columns.first == 0 && columns.step == 1) {
+        sample(row, width, r);
+        return;
+    }
+
+    constexpr uint32_t CHUNK  = 64;
+    const uint32_t     count  = columns.first < width ? (width - columns.first + columns.step - 1) / columns.step : 0;
+    const float        stepX  = r.stepX * float(columns.step);
+    const float        stepY  = r.stepY * float(columns.step);
+    Pixel              packed[CHUNK];
+    for (uint32_t i = 0; i < count; i += CHUNK) {
+        const uint32_t n     = std::min(CHUNK, count - i);
+        const float    start = float(columns.first + i * columns.step);
+        sample(packed, n, { r.x + start * r.stepX, r.y + start * r.stepY, stepX, stepY, r.distance });
+        for (uint32_t j = 0; j < n; ++j) {
+            row[columns.first + (i + j) * columns.step] = packed[j];
+        }
+    }
+}
+
+/// Floor textured with `texture`, repeated once per world unit. Each row reads the mip level matching its texel
+/// footprint, see getRowFootprint.
+/// \param texture RowMajor, power-of-two sides, see FloorTexture. Palette indexed for an IndexedFrameView
+/// \param band rows to draw, see ALL_ROWS
+/// \param columns to draw, see ColumnSet
+template <typename Pixel>
+void castFloorTextured(const BasicFrameView<Pixel>& frame,
+                       const FloorView&             view,
+                       const CPUBitmap&             texture,
+                       SimdLevel                    simdLevel = getSimdLevel(),
+                       SpanRows                     band      = ALL_ROWS,
+                       ColumnSet                    columns   = ALL_COLUMNS) {
+    const float   dirX = std::cos(view.dirAngle);
+    const float   dirY = std::sin(view.dirAngle);
+    const int32_t end  = std::min(int32_t(frame.height), band.end);
+    for (int32_t y = std::max(getFloorBegin(frame, view), band.begin); y < end; ++y) {
+        const FloorRow r            = getFloorRow(view, frame.width, y, dirX, dirY);
+        const float    nextDistance = view.camHeight * getRowScale(view, y - view.horizon);
+        drawFloorRow(frame.row(uint32_t(y)), frame.width, r, nextDistance, texture, simdLevel, columns);
+    }
+}
+
+/// Ceiling row: every cell picks its own texture, so texels are looked up one by one. The texture and its mip are only
+/// looked up again when the row enters a new cell.
+/// \param getTexture (int64_t cellX, int64_t cellY) -> const CPUBitmap*, nullptr where there is no ceiling
+/// \param columns of the row to draw, see ColumnSet
+template <typename Pixel, typename GetTexture>
+void drawCeilingRow(Pixel*          row,
+                    uint32_t        width,
+                    const FloorRow& r,
+                    float           nextDistance,
+                    GetTexture&&    getTexture,
+                    ColumnSet       columns = ALL_COLUMNS) {
+    int64_t                  cellX   = INT64_MIN;
+    int64_t                  cellY   = INT64_MIN;
+    const CPUBitmap*         texture = nullptr;
+    BasicFloorTexture<Pixel> tex{};
+    for (uint32_t i = columns.first; i < width; i += columns.step) {
+        const float   worldX = r.x + float(i) * r.stepX;
+        const float   worldY = r.y + float(i) * r.stepY;
+        const int64_t x      = int64_t(std::floor(worldX));
+        const int64_t y      = int64_t(std::floor(worldY));
+        if (x != cellX || y != cellY) {
+            cellX   = x;
+            cellY   = y;
+            texture = getTexture(x, y);
+            if (texture) {
+                const size_t level = texture->selectMip(getRowFootprint(r, nextDistance, texture->width));
+                tex                = BasicFloorTexture<Pixel>::fromMip(*texture, level);
+            }
+        }
+        if (texture) {
+            row[i] = tex.sample(worldX, worldY);
+        }
+    }
+}
+
+/// Floor and ceiling in one sweep: the k-th row below the horizon and the k-th row above it share their row scale and
+/// setup, and differ only by the height of their plane above or below the eye. Ceiling pixels of cells without a
+/// ceiling are left as they are (the sky).
+/// \param ceilingHeight above the floor, world units
+/// \param getCeilingTexture see drawCeilingRow
+/// \param band rows to draw, see ALL_ROWS
+/// \param columns to draw, see ColumnSet
+template <typename Pixel, typename GetTexture>
+void castFloorAndCeiling(const BasicFrameView<Pixel>& frame,
+                         const FloorView&             view,
+                         const CPUBitmap&             floorTexture,
+                         float                        ceilingHeight,
+                         GetTexture&&                 getCeilingTexture,
+                         SimdLevel                    simdLevel = getSimdLevel(),
+                         SpanRows                     band      = ALL_ROWS,
+                         ColumnSet                    columns   = ALL_COLUMNS) {
+    const float    dirX        = std::cos(view.dirAngle);
+    const float    dirY        = std::sin(view.dirAngle);
+    const float    aboveEye    = ceilingHeight - view.camHeight;
+    const int32_t  height      = std::min(int32_t(frame.height), band.end);
+    const SpanRows floorRows   = { std::max(getFloorBegin(frame, view), band.begin), height };
+    const SpanRows ceilingRows = { std::max(0, band.begin), std::min(view.horizon + 1, height) };
+
+    // k-th row away from the horizon: floor row horizon + 1 + k, ceiling row horizon - k. Sweep the k of both
+    // (possibly empty) row ranges
+    int32_t kBegin = INT32_MAX;
+    int32_t kEnd   = 0;
+    if (floorRows.begin < floorRows.end) {
+        kBegin = floorRows.begin - view.horizon - 1;
+        kEnd   = floorRows.end - view.horizon - 1;
+    }
+    if (aboveEye > 0.f && ceilingRows.begin < ceilingRows.end) {
+        kBegin = std::min(kBegin, view.horizon - (ceilingRows.end - 1));
+        kEnd   = std::max(kEnd, view.horizon - ceilingRows.begin + 1);
+    }
+    for (int32_t k = std::max(kBegin, 0); k < kEnd; ++k) {
+        const float scale     = getRowScale(view, k);
+        const float nextScale = getRowScale(view, k + 1);
+
+        const int32_t floorY = view.horizon + 1 + k;
+        if (floorY >= floorRows.begin && floorY < floorRows.end) {
+            const FloorRow r = getPlaneRow(view, frame.width, view.camHeight * scale, dirX, dirY);
+            drawFloorRow(
+                frame.row(uint32_t(floorY)), frame.width, r, view.camHeight * nextScale, floorTexture, simdLevel, columns);
+        }
+
+        const int32_t ceilingY = view.horizon - k;
+        if (aboveEye > 0.f && ceilingY >= ceilingRows.begin && ceilingY < ceilingRows.end) {
+            const FloorRow r = getPlaneRow(view, frame.width, aboveEye * scale, dirX, dirY);
+            drawCeilingRow(frame.row(uint32_t(ceilingY)), frame.width, r, aboveEye * nextScale, getCeilingTexture, columns);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+// Waiting for fixed rate deadlines without burning a core. Free of DirectX / Windows dependencies; the OS specific
+// waiting is a Waiter, e.g. ThreadSleepWaiter here or HighResolutionTimerWaiter in GJWin32Wait.h.
+
+/// Default Waiter: std::this_thread::sleep_for. Fine grained on Linux, but Windows may round it up to the scheduler
+/// tick (15.6 ms), see HighResolutionTimerWaiter.
+struct ThreadSleepWaiter {
+    void sleepFor(std::chrono::nanoseconds duration) { std::this_thread::sleep_for(duration); }
+
+    /// How much later than asked sleepFor may return
+    std::chrono::nanoseconds getSlack() const { return std::chrono::microseconds{ 500 }; }
+};
+
+/// Counted by FramePacer::wait
+struct PacerStats {
+    uint64_t                 waits  = 0;
+    uint64_t                 missed = 0;    //< deadlines that had passed before wait was called
+    std::chrono::nanoseconds maxLateness{}; //< of a return after its deadline, missed or not
+    std::chrono::nanoseconds totalLateness{};
+};
+
+inline void printPacerStats(const char* name, const PacerStats& stats) {
+    using Ms              = std::chrono::duration<double, std::milli>;
+    const double meanLate = stats.waits ? Ms(stats.totalLateness).count() / double(stats.waits) : 0.;
+    std::cout << name << " pacer: " << stats.waits << " waits, " << stats.missed << " missed, late by " << meanLate
+              << " ms on average, " << Ms(stats.maxLateness).count() << " ms at most\n";
+}
+
+/// Returns from wait at a fixed rate: sleeps with the Waiter until its slack before the deadline, then spins for the
+/// rest. Deadlines follow each other by exactly one period, so waking late does not make the rate drift.
+/// \tparam Waiter has `void sleepFor(std::chrono::nanoseconds)` and `std::chrono::nanoseconds getSlack() const`
+template <typename Waiter = ThreadSleepWaiter>
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// \param rate deadlines per second, > 0
+    explicit FramePacer(double rate, Waiter _waiter = {})
+        : period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1. / rate)))
+        , waiter(std::move(_waiter))
+        , deadline(Clock::now() + period) {}
+
+    /// Returns at the next deadline. A deadline that passed already returns at once and counts as missed; the next
+    /// one is then a period after the missed one, or after now if that passed too, so a stall is not caught up on.
+    /// \return false if the deadline was missed
+    bool wait() {
+        ++stats.waits;
+        Clock::time_point now = Clock::now();
+        if (now >= deadline) {
+            ++stats.missed;
+            record(now - deadline);
+            deadline += period;
+            if (deadline <= now) {
+                deadline = now + period;
+            }
+            return false;
+        }
+        const Clock::duration slack = waiter.getSlack();
+        if (deadline - now > slack) {
+            waiter.sleepFor(deadline - now - slack);
+        }
+        while ((now = Clock::now()) < deadline) {
+            std::this_thread::yield();
+        }
+        record(now - deadline);
+        deadline += period;
+        return true;
+    }
+
+    const PacerStats& getStats() const { return stats; }
+    Clock::duration   getPeriod() const { return period; }
+
+private:
+    void record(Clock::duration lateness) {
+        stats.maxLateness = std::max(stats.maxLateness, std::chrono::duration_cast<std::chrono::nanoseconds>(lateness));
+        stats.totalLateness += lateness;
+    }
+
+    Clock::duration   period;
+    Waiter            waiter;
+    Clock::time_point deadline;
+    PacerStats        stats;
+};
@@ -0,0 +1,234 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+
+#include "GJRaster.h"
+#include "GJRaycast.h"
+#include "GJSimd.h"
+
+// Interlaced rendering of the 3D view: a frame draws every other column, alternating between frames, and reconstructs
+// the rest from the previous frame. Free of DirectX / Windows dependencies.
+
+/// What reprojecting a frame needs to know about the camera it was drawn with.
+struct InterlaceCamera {
+    float    camX;
+    float    camY;
+    float    camHeight;
+    float    dirAngle; //< radians
+    int32_t  horizon;  //< see GJRenderer::getHorizon
+    float    imagePlaneDistance;
+    uint32_t width;
+    uint32_t height;
+};
+
+/// Per channel minimum and maximum of packed BGRA, and the rounded-up mean, as _mm_min_epu8 / _mm_max_epu8 / _mm_avg_epu8
+inline uint32_t minBGRA(uint32_t a, uint32_t b) {
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        result |= std::min((a >> shift) & 0xFF, (b >> shift) & 0xFF) << shift;
+    }
+    return result;
+}
+
+inline uint32_t maxBGRA(uint32_t a, uint32_t b) {
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        result |= std::max((a >> shift) & 0xFF, (b >> shift) & 0xFF) << shift;
+    }
+    return result;
+}
+
+inline uint32_t averageBGRA(uint32_t a, uint32_t b) {
+    uint32_t result = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        result |= ((((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + 1) / 2) << shift;
+    }
+    return result;
+}
+
+/// The previous frame's pixel at a missing one: `history` shifted down by rowShift rows, and column x read from
+/// historyColumns[x], -1 where the previous frame did not see what column x sees.
+struct Reprojection {
+    FrameView      history;
+    const int32_t* historyColumns;
+    int32_t        rowShift;
+};
+
+/// Missing pixel (x, y): its reprojected history, clamped per channel to the range of the drawn pixels left and right
+/// of it, so whatever moved since (sprites, parallax of near things) can not leave a trail. Where there is no history,
+/// the mean of those two. A wider clamp range, over the rows above and below too, lets more of the reprojection's
+/// error through while the camera moves than it keeps detail while it stands still.
+inline void reconstructPixelsScalar(const FrameView&    frame,
+                                    const Reprojection& reprojection,
+                                    uint32_t            y,
+                                    uint32_t            xBegin,
+                                    uint32_t            xEnd) {
+    const uint32_t  width    = frame.width;
+    const int32_t   historyY = int32_t(y) - reprojection.rowShift;
+    const uint32_t* history =
+        historyY >= 0 && historyY < int32_t(frame.height) ? reprojection.history.row(uint32_t(historyY)) : nullptr;
+
+    uint32_t* row = frame.row(y);
+    for (uint32_t x = xBegin; x < xEnd; x += 2) {
+        // the first and last column miss a neighbor: use the other twice
+        const uint32_t left  = row[x > 0 ? x - 1 : x + 1];
+        const uint32_t right = row[x + 1 < width ? x + 1 : x - 1];
+        const int32_t  from  = reprojection.historyColumns[x];
+        if (!history || from < 0) {
+            row[x] = averageBGRA(left, right);
+        } else {
+            row[x] = minBGRA(maxBGRA(history[from], minBGRA(left, right)), maxBGRA(left, right));
+        }
+    }
+}
+
+#if GJ_SIMD_X86
+
+/// Four missing pixels per iteration, from the drawn pixels between them. Same results as reconstructPixelsScalar.
+/// \param xBegin >= 1. \return first missing column not reconstructed, the rest is left to the caller
+GJ_TARGET_SSE41 inline uint32_t reconstructPixelsSSE41(const FrameView&    frame,
+                                                       const Reprojection& reprojection,
+                                                       uint32_t            y,
+                                                       uint32_t            xBegin,
+                                                       uint32_t            xEnd) {
+    const int32_t historyY = int32_t(y) - reprojection.rowShift;
+    if (historyY < 0 || historyY >= int32_t(frame.height) || xBegin == 0) {
+        return xBegin;
+    }
+    const uint32_t* history = reprojection.history.row(uint32_t(historyY));
+    const int32_t*  columns = reprojection.historyColumns;
+    uint32_t*       row     = frame.row(y);
+
+    // pixels 0, 2, 4 and 6: from x - 1 the drawn neighbors left of x, x + 2, x + 4 and x + 6
+    auto drawnFrom = [](const uint32_t* pixels) {
+        const __m128 lo = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)));
+        const __m128 hi = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 4)));
+        return _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+    };
+
+    uint32_t x = xBegin;
+    for (; x + 8 <= xEnd && x + 8 < frame.width; x += 8) { //< reads up to x + 8
+        const __m128i left  = drawnFrom(row + x - 1);
+        const __m128i right = drawnFrom(row + x + 1);
+
+        const __m128i from    = _mm_setr_epi32(columns[x], columns[x + 2], columns[x + 4], columns[x + 6]);
+        const __m128i missing = _mm_cmplt_epi32(from, _mm_setzero_si128());
+        const __m128i past    = _mm_setr_epi32(int32_t(history[std::max(columns[x], 0)]),
+                                            int32_t(history[std::max(columns[x + 2], 0)]),
+                                            int32_t(history[std::max(columns[x + 4], 0)]),
+                                            int32_t(history[std::max(columns[x + 6], 0)]));
+        const __m128i clamped = _mm_min_epu8(_mm_max_epu8(past, _mm_min_epu8(left, right)), _mm_max_epu8(left, right));
+        const __m128i result  = _mm_blendv_epi8(clamped, _mm_avg_epu8(left, right), missing);
+
+        // interleaved with the drawn pixels right of them, which are stored back unchanged
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_unpacklo_epi32(result, right));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x + 4), _mm_unpackhi_epi32(result, right));
+    }
+    return x;
+}
+
+#endif // GJ_SIMD_X86
+
+/// Fills the columns of rows `band` that `drawn` left out, see reconstructPixelsScalar. Reads and writes only rows
+/// `band`, once their drawn pixels are final.
+/// \param drawn every other column, see Interlacer::beginFrame
+inline void reconstructColumns(const FrameView&    frame,
+                               ColumnSet           drawn,
+                               const Reprojection& reprojection,
+                               SpanRows            band,
+                               SimdLevel           simdLevel = getSimdLevel()) {
+    if (frame.width < 2) {
+        return;
+    }
+    const uint32_t missingFirst = 1 - drawn.first;
+    band.end                    = std::min(band.end, int32_t(frame.height));
+    for (int32_t y = std::max(band.begin, 0); y < band.end; ++y) {
+        uint32_t x = missingFirst;
+#if GJ_SIMD_X86
+        if (simdLevel >= SimdLevel::SSE41) {
+            if (x == 0) {
+                reconstructPixelsScalar(frame, reprojection, uint32_t(y), 0, 1);
+                x = 2;
+            }
+            x = reconstructPixelsSSE41(frame, reprojection, uint32_t(y), x, frame.width);
+        }
+#endif
+        reconstructPixelsScalar(frame, reprojection, uint32_t(y), x, frame.width);
+    }
+}
+
+/// Decides per frame whether the previous one can stand in for half of the columns, and where it shows them. The
+/// previous frame is reprojected by the camera's turn and pitch only; moving the camera shifts near things more than
+/// far ones, which the neighbor clamp of reconstructPixelsScalar hides while the motion is small. Faster turns and
+/// moves, and any change to the frame size or field of view, draw a full frame instead.
+class Interlacer {
+public:
+    static constexpr float MAX_TURN = 0.05f; //< radians per frame, ~3 degrees
+    static constexpr float MAX_MOVE = 0.1f;  //< world units per frame, across and up
+
+    /// Call once per frame, before drawing. The frame must end up whole: its drawn columns plus, if it was
+    /// interlaced, reconstructColumns with getReprojection.
+    /// \param rays of this frame, see ColumnRayTable
+    /// \return columns to draw: every other one, alternating, or ALL_COLUMNS
+    ColumnSet beginFrame(const InterlaceCamera& camera, const ColumnRayTable& rays) {
+        const float turn = std::remainder(camera.dirAngle - previous.dirAngle, 2.f * std::numbers::pi_v<float>);
+        const float move = std::hypot(camera.camX - previous.camX, camera.camY - previous.camY) +
+                           std::abs(camera.camHeight - previous.camHeight);
+        const bool reuse = hasPrevious && camera.width == previous.width && camera.height == previous.height &&
+                           camera.imagePlaneDistance == previous.imagePlaneDistance && std::abs(turn) <= MAX_TURN &&
+                           move <= MAX_MOVE;
+        const ColumnSet previousDrawn = previousColumns;
+        rowShift                      = camera.horizon - previous.horizon;
+        previous                      = camera;
+        hasPrevious                   = true;
+        previousColumns               = ALL_COLUMNS;
+        if (!reuse) {
+            return previousColumns;
+        }
+
+        parity          = 1 - parity;
+        previousColumns = { parity, 2 };
+        historyColumns.resize(camera.width);
+        for (uint32_t x = 1 - parity; x < camera.width; x += 2) {
+            historyColumns[x] = getHistoryColumn(rays, x, turn, previousDrawn);
+        }
+        return previousColumns;
+    }
+
+    /// Where an interlaced frame finds the previous one, which `history` holds
+    Reprojection getReprojection(const FrameView& history) const { return { history, historyColumns.data(), rowShift }; }
+
+    /// The next frame is drawn whole, e.g. after the history was drawn over
+    void reset() { hasPrevious = false; }
+
+private:
+    /// \return column of the previous frame that saw in the direction column x sees now, -1 if it was off screen. Only
+    /// columns the previous frame drew count: reading its reconstructed ones would carry their error on from frame to
+    /// frame
+    /// \param drawn columns of the previous frame
+    static int32_t getHistoryColumn(const ColumnRayTable& rays, uint32_t x, float turn, ColumnSet drawn) {
+        if (turn == 0.f) {
+            return int32_t(x); //< the previous frame drew the columns this one leaves out
+        }
+        // invert ColumnRayTable::rebuild: the column's angle to the view direction, before the turn
+        const float angle = std::atan2(rays.camY[x], rays.camX[x]) + turn;
+        if (std::abs(angle) >= std::numbers::pi_v<float> / 2.f) {
+            return -1;
+        }
+        const float   pixelDirection = rays.imagePlaneDistance * std::tan(angle);
+        const float   column         = pixelDirection * float(rays.width) + float(rays.width / 2);
+        const float   step           = float(drawn.step);
+        const int32_t nearest = int32_t(std::floor((column - float(drawn.first)) / step + 0.5f) * step) + int32_t(drawn.first);
+        return nearest >= 0 && nearest < int32_t(rays.width) ? nearest : -1;
+    }
+
+    InterlaceCamera      previous{};
+    ColumnSet            previousColumns = ALL_COLUMNS; //< drawn by the previous frame
+    bool                 hasPrevious     = false;
+    uint32_t             parity      = 0;
+    int32_t              rowShift    = 0;
+    std::vector<int32_t> historyColumns; //< by column of this frame, only the missing ones are set
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "GJRaster.h"
+#include "GJTileMap.h"
+
+// The minimap's tile layer, kept as an image. Free of DirectX / Windows dependencies; the backend upload is the
+// renderer's, see GJRenderer::syncMinimap.
+
+/// What MinimapImage::sync changed
+struct MinimapUpdate {
+    bool     resized  = false; //< the image has a new size, create it anew before uploading
+    uint32_t dirtyTop = 0;     //< rows [dirtyTop, dirtyEnd) changed, none if dirtyTop >= dirtyEnd
+    uint32_t dirtyEnd = 0;
+};
+
+/// One premultiplied BGRA texel per tile, darker where the tile is solid. Remembers the grid version and the solid words
+/// it shows, so a sync of an unchanged map returns at once, and one after the map changed redraws only the words that
+/// differ.
+class MinimapImage {
+public:
+    /// Brings the texels up to date with `grid`, drawn at `alpha`. A map of another size, or another alpha, is drawn anew
+    MinimapUpdate sync(const SolidGridView& grid, float alpha) {
+        MinimapUpdate update  = { grid.width != width || grid.height != height, uint32_t(grid.height), 0 };
+        const bool    rebuild = update.resized || alpha != drawnAlpha;
+        if (!rebuild && grid.version != 0 && grid.version == drawnVersion) {
+            return update;
+        }
+        drawnVersion = grid.version;
+        if (update.resized) {
+            width  = grid.width;
+            height = grid.height;
+            texels.assign(size_t(grid.width * grid.height), 0);
+            solid.assign(size_t(grid.wordsPerRow * grid.height), 0);
+        }
+        drawnAlpha = alpha;
+
+        const uint32_t solidTexel = packBGRA(0.2f * alpha, 0.2f * alpha, 0.2f * alpha, alpha); //< premultiplied
+        const uint32_t emptyTexel = packBGRA(alpha, alpha, alpha, alpha);
+        for (uint64_t y = 0; y < grid.height; ++y) {
+            for (uint64_t word = 0; word < grid.wordsPerRow; ++word) {
+                const size_t   index = size_t(y * grid.wordsPerRow + word);
+                const uint64_t bits  = grid.words[index];
+                if (!rebuild && bits == solid[index]) {
+                    continue;
+                }
+                solid[index]         = bits;
+                uint32_t*      row   = texels.data() + y * grid.width;
+                const uint64_t begin = word * 64;
+                const uint64_t end   = std::min(begin + 64, grid.width);
+                for (uint64_t x = begin; x < end; ++x) {
+                    row[x] = (bits >> (x - begin)) & 1 ? solidTexel : emptyTexel;
+                }
+                update.dirtyTop = std::min(update.dirtyTop, uint32_t(y));
+                update.dirtyEnd = uint32_t(y) + 1;
+            }
+        }
+        return update;
+    }
+
+    bool            empty() const { return texels.empty(); }
+    uint64_t        getWidth() const { return width; }
+    uint64_t        getHeight() const { return height; }
+    const uint32_t* getTexels() const { return texels.data(); } //< row major, getWidth() per row
+
+private:
+    std::vector<uint32_t> texels;
+    std::vector<uint64_t> solid;            //< the solid words texels shows
+    uint64_t              width        = 0; //< in tiles
+    uint64_t              height       = 0;
+    float                 drawnAlpha   = -1.f;
+    uint64_t              drawnVersion = 0; //< of the grid texels shows, see SolidGridView::version
+};
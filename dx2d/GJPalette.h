@@ -0,0 +1,295 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "GJRaster.h"
+#include "GJSimd.h"
+#include "GJTexture.h"
+
+// 256 color palette for the indexed render mode. Free of DirectX / Windows dependencies.
+
+/// Steps of light a colormap holds, from black (0) to unshaded (LIGHT_LEVELS).
+constexpr uint32_t LIGHT_LEVELS = 32;
+
+/// \param light [0..256], see shadeBGRA. \return [0..LIGHT_LEVELS], see Palette::getColormap
+inline uint32_t getLightLevel(uint32_t light) {
+    return (std::min(light, 256U) * LIGHT_LEVELS + 128) / 256;
+}
+
+/// Colors the indexed render mode draws with, picked from the textures by median cut, and the tables that turn
+/// per-pixel shading and blending into lookups. Index TRANSPARENT_INDEX is reserved for holes in textures.
+class Palette {
+public:
+    /// Picks the palette for `textures` (4 channel) and `extraColors`, then fills the lookup tables.
+    /// Textures are weighted by their texel count, at full light and at three darker levels, so there are shades left
+    /// for the fog.
+    void build(std::span<const CPUBitmap* const> textures, std::span<const uint32_t> extraColors) {
+        std::vector<uint32_t> histogram(CELLS, 0);
+        auto                  add = [&histogram](uint32_t color, uint32_t count) {
+            for (uint32_t light : { 256U, 192U, 128U, 64U }) {
+                histogram[getCell(shadeBGRA(color, light))] += count;
+            }
+        };
+        for (const CPUBitmap* texture : textures) {
+            const uint32_t* texels = texture->texels();
+            for (size_t i = 0; i < texture->width * texture->height; ++i) {
+                if (texels[i] >= 0x80000000) {
+                    add(texels[i], 1);
+                }
+            }
+        }
+        for (uint32_t color : extraColors) {
+            add(color, 1);
+        }
+        histogram[getCell(0xFF000000)] += 1; //< what light level 0 shades everything to
+
+        medianCut(histogram);
+        buildInverse();
+        buildColormaps();
+        buildTranslucency();
+    }
+
+    /// BGRA of every index, opaque. TRANSPARENT_INDEX is black
+    const std::array<uint32_t, 256>& getColors() const { return colors; }
+
+    /// \return index of the palette color closest to `color`, never TRANSPARENT_INDEX
+    uint8_t nearest(uint32_t color) const { return inverse[getCell(color)]; }
+
+    /// \return 256 indices: every color of the palette shaded to `level`, see getLightLevel. LIGHT_LEVELS maps every
+    /// index to itself, a darker level never to a brighter color than the level above. TRANSPARENT_INDEX maps to itself
+    const uint8_t* getColormap(uint32_t level) const {
+        return colormaps.data() + size_t(std::min(level, LIGHT_LEVELS)) * 256;
+    }
+
+    /// \return 256 x 256 indices: [src * 256 + dst] is src blended half over dst, for translucent walls
+    const uint8_t* getTranslucency() const { return translucency.data(); }
+
+    /// \return `texture` (4 channel, any layout, with or without mips) as a 1 channel bitmap of palette indices with
+    /// the same layout and mips. Texels with alpha < 128 become TRANSPARENT_INDEX. The data carries 3 bytes of padding
+    /// so kernels may read the last index with a 32-bit load
+    CPUBitmap quantize(const CPUBitmap& texture) const {
+        CPUBitmap       indexed = { texture.width, texture.height, 1, {}, texture.layout, texture.mips };
+        const size_t    count   = texture.data.size() / 4;
+        const uint32_t* texels  = reinterpret_cast<const uint32_t*>(texture.data.data());
+        indexed.data.resize(count + 3, TRANSPARENT_INDEX);
+        for (size_t i = 0; i < count; ++i) {
+            indexed.data[i] = texels[i] < 0x80000000 ? TRANSPARENT_INDEX : nearest(texels[i]);
+        }
+        return indexed;
+    }
+
+private:
+    static constexpr uint32_t CELLS = 32 * 32 * 32; //< 5 bits per channel
+
+    static uint32_t getCell(uint32_t color) {
+        return ((color >> 9) & 0x7C00) | ((color >> 6) & 0x03E0) | ((color >> 3) & 0x001F);
+    }
+
+    /// Center of a cell as an opaque BGRA color
+    static uint32_t getCellColor(uint32_t cell) {
+        auto channel = [cell](uint32_t shift) { return (((cell >> shift) & 31) * 255 + 15) / 31; };
+        return 0xFF000000 | (channel(10) << 16) | (channel(5) << 8) | channel(0);
+    }
+
+    /// Splits the occupied cells into up to 255 boxes, the most populous and widest first, and gives every box's
+    /// weighted mean color an index.
+    void medianCut(const std::vector<uint32_t>& histogram) {
+        struct Entry {
+            uint32_t cell;
+            uint32_t count;
+        };
+        struct Box {
+            size_t   begin;
+            size_t   end;
+            uint64_t count;
+        };
+        std::vector<Entry> entries;
+        for (uint32_t cell = 0; cell < CELLS; ++cell) {
+            if (histogram[cell] > 0) {
+                entries.push_back({ cell, histogram[cell] });
+            }
+        }
+
+        auto channel     = [](const Entry& e, uint32_t axis) { return (e.cell >> (10 - 5 * axis)) & 31; };
+        auto longestAxis = [&](const Box& box, uint32_t& range) {
+            uint32_t axis = 0;
+            range         = 0;
+            for (uint32_t a = 0; a < 3; ++a) {
+                uint32_t lo = 31, hi = 0;
+                for (size_t i = box.begin; i < box.end; ++i) {
+                    lo = std::min(lo, channel(entries[i], a));
+                    hi = std::max(hi, channel(entries[i], a));
+                }
+                if (hi - lo >= range) {
+                    range = hi - lo;
+                    axis  = a;
+                }
+            }
+            return axis;
+        };
+
+        std::vector<Box> boxes = { { 0, entries.size(), 0 } };
+        for (const Entry& e : entries) {
+            boxes[0].count += e.count;
+        }
+        while (boxes.size() < 255) {
+            // the box with the most texels times its widest extent; single cells can not be split
+            size_t   best      = boxes.size();
+            uint64_t bestScore = 0;
+            for (size_t b = 0; b < boxes.size(); ++b) {
+                uint32_t range = 0;
+                longestAxis(boxes[b], range);
+                const uint64_t score = boxes[b].count * range;
+                if (boxes[b].end - boxes[b].begin > 1 && score > bestScore) {
+                    best      = b;
+                    bestScore = score;
+                }
+            }
+            if (best == boxes.size()) {
+                break;
+            }
+
+            Box&           box   = boxes[best];
+            uint32_t       range = 0;
+            const uint32_t axis  = longestAxis(box, range);
+            std::sort(entries.begin() + box.begin, entries.begin() + box.end, [&](const Entry& a, const Entry& b) {
+                return channel(a, axis) < channel(b, axis);
+            });
+            // split at the weighted median, leaving at least one cell on either side
+            size_t   split = box.begin + 1;
+            uint64_t below = entries[box.begin].count;
+            while (split + 1 < box.end && below * 2 < box.count) {
+                below += entries[split++].count;
+            }
+            const Box upper = { split, box.end, box.count - below };
+            box             = { box.begin, split, below };
+            boxes.push_back(upper);
+        }
+
+        colors.fill(0xFF000000);
+        for (size_t b = 0; b < boxes.size(); ++b) {
+            uint64_t sum[3] = {};
+            for (size_t i = boxes[b].begin; i < boxes[b].end; ++i) {
+                const uint32_t color = getCellColor(entries[i].cell);
+                for (uint32_t a = 0; a < 3; ++a) {
+                    sum[a] += uint64_t((color >> (16 - 8 * a)) & 0xFF) * entries[i].count;
+                }
+            }
+            uint32_t color = 0xFF000000;
+            for (uint32_t a = 0; a < 3; ++a) {
+                color |= uint32_t((sum[a] + boxes[b].count / 2) / boxes[b].count) << (16 - 8 * a);
+            }
+            colors[b + 1] = color;
+        }
+        colorCount = uint32_t(boxes.size()) + 1;
+    }
+
+    /// Closest color of every cell, by brute force. Once per build
+    void buildInverse() {
+        inverse.resize(CELLS);
+        for (uint32_t cell = 0; cell < CELLS; ++cell) {
+            const uint32_t color    = getCellColor(cell);
+            uint32_t       bestDist = UINT32_MAX;
+            for (uint32_t i = 1; i < colorCount; ++i) {
+                uint32_t dist = 0;
+                for (uint32_t shift : { 16U, 8U, 0U }) {
+                    const int32_t d = int32_t((color >> shift) & 0xFF) - int32_t((colors[i] >> shift) & 0xFF);
+                    dist += uint32_t(d * d);
+                }
+                if (dist < bestDist) {
+                    bestDist      = dist;
+                    inverse[cell] = uint8_t(i);
+                }
+            }
+        }
+    }
+
+    /// Integer luma, Rec. 601 weights
+    static uint32_t getLuma(uint32_t color) {
+        return 299 * ((color >> 16) & 0xFF) + 587 * ((color >> 8) & 0xFF) + 114 * (color & 0xFF);
+    }
+
+    /// Unshaded, every index is itself: nearest() goes through the 5:5:5 cells and may pick a neighbor. From there
+    /// down, the nearest color of each shade, unless it is brighter than what the level above picked, so that the
+    /// cells' rounding can not make a texel lighter as the light drops.
+    void buildColormaps() {
+        colormaps.resize(size_t(LIGHT_LEVELS + 1) * 256);
+        uint8_t* unshaded = colormaps.data() + size_t(LIGHT_LEVELS) * 256;
+        for (uint32_t i = 0; i < 256; ++i) {
+            unshaded[i] = uint8_t(i);
+        }
+        for (uint32_t level = LIGHT_LEVELS; level-- > 0;) {
+            uint8_t*       map   = colormaps.data() + size_t(level) * 256;
+            const uint8_t* above = map + 256;
+            for (uint32_t i = 0; i < 256; ++i) {
+                const uint8_t shaded = nearest(shadeBGRA(colors[i], level * 256 / LIGHT_LEVELS));
+                map[i]               = getLuma(colors[shaded]) > getLuma(colors[above[i]]) ? above[i] : shaded;
+            }
+            map[TRANSPARENT_INDEX] = TRANSPARENT_INDEX;
+        }
+    }
+
+    void buildTranslucency() {
+        translucency.resize(256 * 256);
+        for (uint32_t src = 0; src < 256; ++src) {
+            for (uint32_t dst = 0; dst < 256; ++dst) {
+                translucency[src * 256 + dst] =
+                    src == TRANSPARENT_INDEX ? uint8_t(dst) : nearest(blendBGRA(colors[dst], colors[src], 128));
+            }
+        }
+    }
+
+    std::array<uint32_t, 256> colors     = {};
+    uint32_t                  colorCount = 1; //< indices [colorCount, 256) repeat black and are never picked
+    std::vector<uint8_t>      inverse;        //< by 5:5:5 cell
+    std::vector<uint8_t>      colormaps;      //< [LIGHT_LEVELS + 1][256]
+    std::vector<uint8_t>      translucency;   //< [256][256]
+};
+
+/// Writes the BGRA color of `count` palette indices. The renderer's final pass over an IndexedFrameView.
+inline void expandIndexedScalar(const uint8_t* indices, uint32_t* pixels, size_t count, const uint32_t* colors) {
+    for (size_t i = 0; i < count; ++i) {
+        pixels[i] = colors[indices[i]];
+    }
+}
+
+#if GJ_SIMD_X86
+
+/// \return number of pixels written. The remaining (count % 8) are left to the caller
+GJ_TARGET_AVX2 inline size_t expandIndexedAVX2(const uint8_t* indices, uint32_t* pixels, size_t count, const uint32_t* colors) {
+    const int* table = reinterpret_cast<const int*>(colors);
+    size_t     i     = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i), _mm256_i32gather_epi32(table, index, 4));
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+#endif // GJ_SIMD_X86
+
+/// Rows `band` of `indexed` into the same rows of `frame`, which has the same size.
+inline void expandIndexed(const IndexedFrameView& indexed,
+                          const FrameView&        frame,
+                          const Palette&          palette,
+                          SpanRows                band,
+                          SimdLevel               simdLevel = getSimdLevel()) {
+    band.end = std::min(band.end, int32_t(frame.height));
+    if (band.begin >= band.end) {
+        return;
+    }
+    const uint8_t* indices = indexed.row(uint32_t(band.begin));
+    uint32_t*      pixels  = frame.row(uint32_t(band.begin));
+    const size_t   count   = size_t(band.end - band.begin) * frame.width;
+    size_t         done    = 0;
+#if GJ_SIMD_X86
+    if (simdLevel == SimdLevel::AVX2) {
+        done = expandIndexedAVX2(indices, pixels, count, palette.getColors().data());
+    }
+#endif
+    expandIndexedScalar(indices + done, pixels + done, count - done, palette.getColors().data());
+}
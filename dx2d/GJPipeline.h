@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <utility>
+
+// Compile-time specialized pipelines: code templated on a mask of features, and tables of the instantiations that can
+// be picked at runtime. Free of DirectX / Windows dependencies.
+
+/// Scatters the low bits of `bits` to the set bits of `mask`, lowest first, as _pdep_u32
+constexpr uint32_t depositBits(uint32_t bits, uint32_t mask) {
+    uint32_t result = 0;
+    for (uint32_t bit = 1; mask != 0; bit <<= 1) {
+        const uint32_t lowest = mask & (~mask + 1);
+        if (bits & bit) {
+            result |= lowest;
+        }
+        mask ^= lowest;
+    }
+    return result;
+}
+
+/// Gathers the bits of `value` under `mask` into the low bits, as _pext_u32. Inverse of depositBits
+constexpr uint32_t extractBits(uint32_t value, uint32_t mask) {
+    uint32_t result = 0;
+    for (uint32_t bit = 1; mask != 0; bit <<= 1) {
+        const uint32_t lowest = mask & (~mask + 1);
+        if (value & lowest) {
+            result |= bit;
+        }
+        mask ^= lowest;
+    }
+    return result;
+}
+
+/// One instantiation per combination of the features in RUNTIME, each with every feature of FIXED, so only those are
+/// compiled. Features outside both are off in all of them.
+/// \tparam Make has `template <uint32_t FEATURES> Entry operator()() const`, e.g. returning &f<FEATURES>
+template <uint32_t FIXED, uint32_t RUNTIME, typename Entry>
+class FeatureTable {
+    static_assert((FIXED & RUNTIME) == 0, "a feature is either fixed or picked at runtime");
+    static_assert(std::popcount(RUNTIME) <= 6, "instantiations double with every runtime feature");
+
+public:
+    static constexpr uint32_t SIZE = 1U << std::popcount(RUNTIME);
+
+    template <typename Make>
+    constexpr explicit FeatureTable(Make make)
+        : entries([&make]<uint32_t... I>(std::integer_sequence<uint32_t, I...>) {
+            return std::array<Entry, SIZE>{ make.template operator()<FIXED | depositBits(I, RUNTIME)>()... };
+        }(std::make_integer_sequence<uint32_t, SIZE>{})) {}
+
+    /// \return the instantiation for `features`, of which only those in RUNTIME matter
+    constexpr Entry operator[](uint32_t features) const { return entries[extractBits(features, RUNTIME)]; }
+
+private:
+    std::array<Entry, SIZE> entries;
+};
@@ -0,0 +1,316 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// CPU rasterization into the renderer's drawBuffer. Free of DirectX / Windows dependencies so the span fillers can be
+// unit-tested and benchmarked on any platform.
+
+/// Row-major pixels.
+template <typename Pixel>
+struct BasicFrameView {
+    Pixel*   pixels = nullptr;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+
+    Pixel* row(uint32_t y) const { return pixels + size_t(y) * width; }
+};
+
+/// 32-bit pixels as uploaded to the GPU: B, G, R, A in memory, i.e. 0xAARRGGBB as uint32_t.
+using FrameView = BasicFrameView<uint32_t>;
+
+/// 8-bit palette indices, expanded to a FrameView once per frame. See GJPalette.h
+using IndexedFrameView = BasicFrameView<uint8_t>;
+
+/// Palette index of texels with alpha < 128. Never drawn, never matched by a color
+constexpr uint8_t TRANSPARENT_INDEX = 0;
+
+/// \param r, g, b, a [0..1], clamped
+inline uint32_t packBGRA(float r, float g, float b, float a = 1.f) {
+    auto toByte = [](float c) { return uint32_t(std::clamp(c, 0.f, 1.f) * 255.f + 0.5f); };
+    return (toByte(a) << 24) | (toByte(r) << 16) | (toByte(g) << 8) | toByte(b);
+}
+
+/// Rows whose pixel centers lie in [yTop, yBottom), clipped to the frame.
+struct SpanRows {
+    int32_t begin = 0;
+    int32_t end   = 0; //< exclusive. begin >= end means nothing to draw
+};
+
+/// Rows of the frame a pass may write; the default is all of them. Threads drawing disjoint bands of one frame never
+/// touch the same pixel.
+constexpr SpanRows ALL_ROWS = { 0, INT32_MAX };
+
+/// Columns of the frame a pass draws: every step-th one from first. Interlaced frames draw every other column, see
+/// GJInterlace.h
+struct ColumnSet {
+    uint32_t first = 0;
+    uint32_t step  = 1;
+
+    /// \return first column of the set at or after x
+    uint32_t firstFrom(uint32_t x) const { return x <= first ? first : x + (step - (x - first) % step) % step; }
+};
+
+constexpr ColumnSet ALL_COLUMNS = { 0, 1 };
+
+template <typename Pixel>
+SpanRows clipSpan(const BasicFrameView<Pixel>& frame, float yTop, float yBottom) {
+    if (!(yBottom > yTop)) {
+        return {}; //< empty, upside down, or NaN: the top of a wall at distance 0 is inf - inf
+    }
+    // clamp before converting: spans of walls at distance ~0 reach +-inf
+    const float maxY = float(frame.height);
+    return { int32_t(std::ceil(std::clamp(yTop - 0.5f, 0.f, maxY))),
+             int32_t(std::ceil(std::clamp(yBottom - 0.5f, 0.f, maxY))) };
+}
+
+/// 16.16 fixed point texture v down a column span, sampled at pixel centers
+struct SpanTexV {
+    uint32_t v    = 0; //< of the span's first drawn row
+    uint32_t step = 0; //< per row
+};
+
+/// \param rows drawn rows of the full (unclipped) span [yTop, yBottom), see clipSpan
+inline SpanTexV getSpanTexV(SpanRows rows, float yTop, float yBottom, uint32_t texHeight) {
+    const float height = yBottom - yTop;
+    const float exact  = (float(rows.begin) + 0.5f - yTop) * float(texHeight) / height;
+    const float v      = std::min(std::max(0.f, exact), float(texHeight)); //< 0 for the inf / inf of an infinite span
+    // a span thinner than a pixel draws at most one row, so steps of more than the texture need not be told apart
+    const float texelsPerPixel = std::min(float(texHeight) / height, float(texHeight));
+    return { uint32_t(v * 65536.f), uint32_t(texelsPerPixel * 65536.f) };
+}
+
+/// Fills the vertical span [yTop, yBottom) of column x with a solid color.
+template <typename Pixel>
+void fillColumnSpan(const BasicFrameView<Pixel>& frame,
+                    uint32_t                     x,
+                    float                        yTop,
+                    float                        yBottom,
+                    std::type_identity_t<Pixel>  color) {
+    if (x >= frame.width) {
+        return;
+    }
+    const SpanRows rows   = clipSpan(frame, yTop, yBottom);
+    Pixel*         pixel  = frame.pixels + size_t(rows.begin) * frame.width + x;
+    const size_t   stride = frame.width;
+    for (int32_t y = rows.begin; y < rows.end; ++y, pixel += stride) {
+        *pixel = color;
+    }
+}
+
+/// dst * (1 - alpha) + src * alpha per channel, alpha in [0..256]
+inline uint32_t blendBGRA(uint32_t dst, uint32_t src, uint32_t alpha) {
+    const uint32_t invAlpha = 256 - alpha;
+    uint32_t       rb       = (((src & 0x00FF00FF) * alpha + (dst & 0x00FF00FF) * invAlpha) >> 8) & 0x00FF00FF;
+    uint32_t       g        = (((src & 0x0000FF00) * alpha + (dst & 0x0000FF00) * invAlpha) >> 8) & 0x0000FF00;
+    return 0xFF000000 | rb | g;
+}
+
+/// Scales the color channels by light / 256, alpha is set to opaque. \param light [0..256]
+inline uint32_t shadeBGRA(uint32_t color, uint32_t light) {
+    uint32_t rb = (((color & 0x00FF00FF) * light) >> 8) & 0x00FF00FF;
+    uint32_t g  = (((color & 0x0000FF00) * light) >> 8) & 0x0000FF00;
+    return 0xFF000000 | rb | g;
+}
+
+/// Fills the vertical span [yTop, yBottom) of column x with a texture column stretched over the full (unclipped) span.
+/// \param texColumn `texHeight` contiguous texels, see TexelLayout::ColumnMajor
+/// \param light [0..256], see shadeBGRA
+/// \tparam ALPHA_TEST skip texels with alpha < 128, for sprites
+template <bool ALPHA_TEST = false>
+void drawTexturedColumnSpan(const FrameView& frame,
+                            uint32_t         x,
+                            float            yTop,
+                            float            yBottom,
+                            const uint32_t*  texColumn,
+                            uint32_t         texHeight,
+                            uint32_t         light) {
+    if (x >= frame.width || !(yBottom > yTop)) {
+        return;
+    }
+    const SpanRows rows = clipSpan(frame, yTop, yBottom);
+    if (rows.begin >= rows.end) {
+        return;
+    }
+
+    const SpanTexV texV = getSpanTexV(rows, yTop, yBottom, texHeight);
+    uint32_t       v    = texV.v;
+    const uint32_t vMax = texHeight - 1;
+
+    uint32_t*    pixel  = frame.pixels + size_t(rows.begin) * frame.width + x;
+    const size_t stride = frame.width;
+    for (int32_t y = rows.begin; y < rows.end; ++y, pixel += stride, v += texV.step) {
+        const uint32_t texel = texColumn[std::min(v >> 16, vMax)];
+        if constexpr (ALPHA_TEST) {
+            if (texel < 0x80000000) {
+                continue;
+            }
+        }
+        *pixel = shadeBGRA(texel, light);
+    }
+}
+
+/// Indexed counterpart of drawTexturedColumnSpan: shading is one lookup into `colormap`.
+/// \param texColumn `texHeight` contiguous palette indices, see CPUBitmap::indexColumn
+/// \param colormap 256 indices, the texels' shaded colors, see Palette::getColormap
+/// \param translucency nullptr, or 256 x 256 indices by [texel * 256 + pixel] to blend the texels over the frame, see
+/// Palette::getTranslucency
+/// \tparam ALPHA_TEST skip TRANSPARENT_INDEX texels, for sprites
+template <bool ALPHA_TEST = false>
+void drawIndexedColumnSpan(const IndexedFrameView& frame,
+                           uint32_t                x,
+                           float                   yTop,
+                           float                   yBottom,
+                           const uint8_t*          texColumn,
+                           uint32_t                texHeight,
+                           const uint8_t*          colormap,
+                           const uint8_t*          translucency = nullptr) {
+    if (x >= frame.width || !(yBottom > yTop)) {
+        return;
+    }
+    const SpanRows rows = clipSpan(frame, yTop, yBottom);
+    if (rows.begin >= rows.end) {
+        return;
+    }
+
+    const SpanTexV texV = getSpanTexV(rows, yTop, yBottom, texHeight);
+    uint32_t       v    = texV.v;
+    const uint32_t vMax = texHeight - 1;
+
+    uint8_t*     pixel  = frame.pixels + size_t(rows.begin) * frame.width + x;
+    const size_t stride = frame.width;
+    for (int32_t y = rows.begin; y < rows.end; ++y, pixel += stride, v += texV.step) {
+        const uint8_t texel = texColumn[std::min(v >> 16, vMax)];
+        if constexpr (ALPHA_TEST) {
+            if (texel == TRANSPARENT_INDEX) {
+                continue;
+            }
+        }
+        *pixel = translucency ? translucency[size_t(colormap[texel]) * 256 + *pixel] : colormap[texel];
+    }
+}
+
+/// Like fillColumnSpan, but blends `color` over what is already in the frame.
+/// \param alpha [0..256]
+inline void blendColumnSpan(const FrameView& frame, uint32_t x, float yTop, float yBottom, uint32_t color, uint32_t alpha) {
+    if (x >= frame.width) {
+        return;
+    }
+    const SpanRows rows   = clipSpan(frame, yTop, yBottom);
+    uint32_t*      pixel  = frame.pixels + size_t(rows.begin) * frame.width + x;
+    const size_t   stride = frame.width;
+    for (int32_t y = rows.begin; y < rows.end; ++y, pixel += stride) {
+        *pixel = blendBGRA(*pixel, color, alpha);
+    }
+}
+
+/// Composites the layers of one column front to back: every row remembers how much of what lies behind still shows
+/// through (its transmittance), rows that have become opaque are skipped, and the frame is written once in resolve().
+/// Storage is sized to the frame height once and reset only over the rows a column touched, so it does not allocate per
+/// frame.
+class ColumnCompositor {
+public:
+    void begin(const FrameView& _frame, uint32_t _x) {
+        frame = _frame;
+        x     = _x;
+        if (color.size() != frame.height) {
+            color.assign(frame.height, 0);
+            transmittance.assign(frame.height, 256);
+        }
+        touched    = { int32_t(frame.height), 0 };
+        opaqueRows = 0;
+    }
+
+    /// Every row of the column is covered: nothing behind the layers added so far can show.
+    bool isOpaque() const { return opaqueRows == frame.height; }
+
+    /// Adds a texture column behind the layers added so far, stretched over the full (unclipped) span [yTop, yBottom).
+    /// \param opacity [0..256] of the layer's texels
+    /// \param light [0..256], see shadeBGRA
+    /// \tparam ALPHA_TEST texels with alpha < 128 let everything through
+    template <bool ALPHA_TEST>
+    void addTexturedSpan(float           yTop,
+                         float           yBottom,
+                         const uint32_t* texColumn,
+                         uint32_t        texHeight,
+                         uint32_t        light,
+                         uint32_t        opacity) {
+        if (x >= frame.width || !(yBottom > yTop)) {
+            return;
+        }
+        const SpanRows rows = touch(yTop, yBottom);
+
+        const SpanTexV texV = getSpanTexV(rows, yTop, yBottom, texHeight);
+        uint32_t       v    = texV.v;
+        const uint32_t vMax = texHeight - 1;
+        for (int32_t y = rows.begin; y < rows.end; ++y, v += texV.step) {
+            if (transmittance[y] == 0) {
+                continue;
+            }
+            const uint32_t texel = texColumn[std::min(v >> 16, vMax)];
+            if constexpr (ALPHA_TEST) {
+                if (texel < 0x80000000) {
+                    continue;
+                }
+            }
+            accumulate(y, texel, light, opacity);
+        }
+    }
+
+    /// Adds a solid color behind the layers added so far. \param opacity [0..256]
+    void addFilledSpan(float yTop, float yBottom, uint32_t fill, uint32_t opacity) {
+        if (x >= frame.width) {
+            return;
+        }
+        const SpanRows rows = touch(yTop, yBottom);
+        for (int32_t y = rows.begin; y < rows.end; ++y) {
+            if (transmittance[y] != 0) {
+                accumulate(y, fill, 256, opacity);
+            }
+        }
+    }
+
+    /// Blends the layers over what the frame already holds in this column, and resets the touched rows.
+    void resolve() {
+        if (touched.begin >= touched.end) {
+            return;
+        }
+        uint32_t*    pixel  = frame.pixels + size_t(touched.begin) * frame.width + x;
+        const size_t stride = frame.width;
+        for (int32_t y = touched.begin; y < touched.end; ++y, pixel += stride) {
+            if (transmittance[y] != 256) {
+                *pixel = 0xFF000000 | (color[y] + (shadeBGRA(*pixel, transmittance[y]) & 0x00FFFFFF));
+            }
+            color[y]         = 0;
+            transmittance[y] = 256;
+        }
+    }
+
+private:
+    SpanRows touch(float yTop, float yBottom) {
+        const SpanRows rows = clipSpan(frame, yTop, yBottom);
+        if (rows.begin < rows.end) {
+            touched = { std::min(touched.begin, rows.begin), std::max(touched.end, rows.end) };
+        }
+        return rows;
+    }
+
+    /// Weights of all layers of a row and its final transmittance sum up to 256, so the channels never carry over.
+    void accumulate(int32_t y, uint32_t texel, uint32_t light, uint32_t opacity) {
+        const uint32_t weight = (transmittance[y] * opacity) >> 8;
+        color[y] += shadeBGRA(texel, (light * weight) >> 8) & 0x00FFFFFF;
+        transmittance[y] = uint16_t(transmittance[y] - weight);
+        if (transmittance[y] == 0) {
+            ++opaqueRows;
+        }
+    }
+
+    FrameView             frame;
+    uint32_t              x          = 0;
+    SpanRows              touched;       //< union of the rows the column's layers cover
+    uint32_t              opaqueRows = 0;
+    std::vector<uint32_t> color;         //< per row, premultiplied sum of the layers so far, alpha unused
+    std::vector<uint16_t> transmittance; //< per row, [0..256] of what lies behind that still shows
+};
@@ -0,0 +1,197 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Raycasting through the tile grid. Kept free of DirectX / Windows dependencies so it can be compiled and checked
+// headless (e.g. against a brute-force box intersection) on any platform.
+
+struct RayHit {
+    enum Side : uint8_t {
+        NULLSIDE,    //< nothing was hit within maxDist
+        NORTH_SOUTH, //< hit a face perpendicular to the y axis
+        EAST_WEST,   //< hit a face perpendicular to the x axis
+    };
+    float   distance = 0.f; //< along the ray, in units of the direction vector's length
+    float   texU     = 0.f; //< [0..1) position of the hit point along the wall face
+    Side    side     = NULLSIDE;
+    int32_t cellX    = -1;
+    int32_t cellY    = -1;
+};
+
+/// \return [0..1) position along the wall face of the point at distance t. The coordinate that varies along the face is y
+/// for EAST_WEST faces and x for NORTH_SOUTH faces.
+inline float wallTexU(float originX, float originY, float dirX, float dirY, float t, RayHit::Side side) {
+    float along = side == RayHit::EAST_WEST ? originY + t * dirY : originX + t * dirX;
+    return along - std::floor(along);
+}
+
+/// Amanatides-Woo grid traversal: visits only the cells that the ray crosses, in order, and calls `onHit(hit)` for every
+/// cell for which `isSolid(x, y)` is true, until `onHit` returns true or the next cell boundary lies further than `maxDist`.
+/// Cells outside [0, width) x [0, height) are treated as empty, so origins outside the map still work. The origin's own
+/// cell is never tested: from inside a solid cell the ray reports the next solid cell it enters, so a camera clipping into
+/// a wall sees out of it instead of facing that wall at distance 0.
+/// \param dirX, dirY should be normalized if distances are to be in world units
+/// \return true if `onHit` stopped the traversal
+template <typename IsSolid, typename OnHit>
+bool traverseRay(float    originX,
+                 float    originY,
+                 float    dirX,
+                 float    dirY,
+                 float    maxDist,
+                 int64_t  width,
+                 int64_t  height,
+                 IsSolid&& isSolid,
+                 OnHit&&   onHit) {
+    constexpr float INF = std::numeric_limits<float>::infinity();
+
+    int64_t mapX = static_cast<int64_t>(std::floor(originX));
+    int64_t mapY = static_cast<int64_t>(std::floor(originY));
+
+    // distance along the ray between two consecutive x (resp. y) cell boundaries
+    const float deltaX = dirX == 0.f ? INF : std::abs(1.f / dirX);
+    const float deltaY = dirY == 0.f ? INF : std::abs(1.f / dirY);
+
+    // distance along the ray to the first x (resp. y) cell boundary
+    int   stepX, stepY;
+    float sideDistX, sideDistY;
+    if (dirX < 0.f) {
+        stepX     = -1;
+        sideDistX = (originX - float(mapX)) * deltaX;
+    } else {
+        stepX     = 1;
+        sideDistX = (float(mapX) + 1.f - originX) * deltaX;
+    }
+    if (dirY < 0.f) {
+        stepY     = -1;
+        sideDistY = (originY - float(mapY)) * deltaY;
+    } else {
+        stepY     = 1;
+        sideDistY = (float(mapY) + 1.f - originY) * deltaY;
+    }
+
+    RayHit hit;
+    while (true) {
+        float t;
+        if (sideDistX < sideDistY) {
+            t = sideDistX;
+            sideDistX += deltaX;
+            mapX += stepX;
+            hit.side = RayHit::EAST_WEST;
+        } else {
+            t = sideDistY;
+            sideDistY += deltaY;
+            mapY += stepY;
+            hit.side = RayHit::NORTH_SOUTH;
+        }
+
+        if (!(t <= maxDist)) { //< also catches a degenerate (0, 0) direction
+            return false;
+        }
+
+        bool inBounds = mapX >= 0 && mapY >= 0 && mapX < width && mapY < height;
+        if (inBounds && isSolid(size_t(mapX), size_t(mapY))) {
+            hit.distance = t;
+            hit.texU     = wallTexU(originX, originY, dirX, dirY, t, hit.side);
+            hit.cellX    = int32_t(mapX);
+            hit.cellY    = int32_t(mapY);
+            if (onHit(hit)) {
+                return true;
+            }
+        }
+    }
+}
+
+/// First solid cell along the ray, see traverseRay.
+/// \return on a miss, distance == maxDist and side == NULLSIDE
+template <typename IsSolid>
+RayHit castRay(float originX, float originY, float dirX, float dirY, float maxDist, int64_t width, int64_t height, IsSolid&& isSolid) {
+    RayHit first;
+    first.distance = maxDist;
+    traverseRay(originX, originY, dirX, dirY, maxDist, width, height, isSolid, [&first](const RayHit& hit) {
+        first = hit;
+        return true;
+    });
+    return first;
+}
+
+/// Most hits one ray collects through see-through cells, including the opaque one that ends it.
+constexpr uint32_t MAX_RAY_LAYERS = 8;
+
+/// Hits of one ray, front to back. Fixed capacity, so tracing maps full of see-through tiles never allocates.
+struct RayHitStack {
+    std::array<RayHit, MAX_RAY_LAYERS> hits;
+    uint32_t                           count  = 0;
+    bool                               opaque = false; //< the last hit is an opaque cell, nothing behind it is visible
+
+    const RayHit* begin() const { return hits.data(); }
+    const RayHit* end() const { return hits.data() + count; }
+};
+
+/// Like castRay, but passes through solid cells for which `isSeeThrough(x, y)` is true, collecting every solid cell hit
+/// until the first opaque one or until MAX_RAY_LAYERS hits.
+template <typename IsSolid, typename IsSeeThrough>
+void castRayLayers(float          originX,
+                   float          originY,
+                   float          dirX,
+                   float          dirY,
+                   float          maxDist,
+                   int64_t        width,
+                   int64_t        height,
+                   IsSolid&&      isSolid,
+                   IsSeeThrough&& isSeeThrough,
+                   RayHitStack&   out) {
+    out.count  = 0;
+    out.opaque = false;
+    traverseRay(originX, originY, dirX, dirY, maxDist, width, height, isSolid, [&](const RayHit& hit) {
+        out.hits[out.count++] = hit;
+        out.opaque            = !isSeeThrough(size_t(hit.cellX), size_t(hit.cellY));
+        return out.opaque || out.count == MAX_RAY_LAYERS;
+    });
+}
+
+/// Camera-space direction and perspective correction factor of every screen column. These depend only on the field of
+/// view and the viewport width, so the table is rebuilt only when one of them changes. Per frame, only the 2D rotation by
+/// the camera angle is left (`rotate`).
+struct ColumnRayTable {
+    bool isValidFor(float _imagePlaneDistance, uint32_t _width) const {
+        return imagePlaneDistance == _imagePlaneDistance && width == _width;
+    }
+
+    /// \param _imagePlaneDistance for an image plane of width 1, see GJScene::Camera::getImagePlaneDistance
+    void rebuild(float _imagePlaneDistance, uint32_t _width) {
+        imagePlaneDistance = _imagePlaneDistance;
+        width              = _width;
+        camX.resize(width);
+        camY.resize(width);
+        fixPersp.resize(width);
+
+        const float halfWidth = float(width / 2);
+        for (uint32_t x = 0; x < width; ++x) {
+            float pixelDirection = (float(x) - halfWidth) / float(width); // -0.5 to 0.5 (because image plane has width 1)
+            float invLength      = 1.f / std::sqrt(imagePlaneDistance * imagePlaneDistance + pixelDirection * pixelDirection);
+            camX[x]              = imagePlaneDistance * invLength;
+            camY[x]              = pixelDirection * invLength;
+            fixPersp[x]          = camX[x]; //< == cos(angle between column and view direction)
+        }
+    }
+
+    /// Rotates every column direction into world space. Straight-line arithmetic over the arrays, so it vectorizes.
+    /// \param cosA, sinA of the camera direction angle, i.e. the camera's normalized direction vector
+    void rotate(float cosA, float sinA, float* outX, float* outY) const {
+        const float* cx = camX.data();
+        const float* cy = camY.data();
+        for (uint32_t x = 0; x < width; ++x) {
+            outX[x] = cx[x] * cosA - cy[x] * sinA;
+            outY[x] = cx[x] * sinA + cy[x] * cosA;
+        }
+    }
+
+    float              imagePlaneDistance = 0.f;
+    uint32_t           width              = 0;
+    std::vector<float> camX;     //< normalized, camera space (x = view direction)
+    std::vector<float> camY;     //< normalized, camera space
+    std::vector<float> fixPersp; //< multiply a ray distance by this to get the perpendicular distance to the image plane
+};
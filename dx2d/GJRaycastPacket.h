@@ -0,0 +1,586 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+#include "GJRaycast.h"
+#include "GJSimd.h"
+#include "GJTileMap.h"
+
+// Packet raycasting: adjacent columns are independent, so they are walked through the tile grid 4 (SSE4.1) or 8 (AVX2)
+// at a time. Lanes whose ray has already terminated are masked off until the whole packet is done.
+
+/// Structure-of-arrays results of one ray per screen column, consumed by the shading pass.
+struct ColumnHits {
+    void resize(size_t count) {
+        distance.resize(count);
+        texU.resize(count);
+        side.resize(count);
+        cellX.resize(count);
+        cellY.resize(count);
+    }
+
+    void set(size_t i, const RayHit& hit) {
+        distance[i] = hit.distance;
+        texU[i]     = hit.texU;
+        side[i]     = hit.side;
+        cellX[i]    = hit.cellX;
+        cellY[i]    = hit.cellY;
+    }
+
+    RayHit get(size_t i) const { return { distance[i], texU[i], side[i], cellX[i], cellY[i] }; }
+
+    size_t size() const { return distance.size(); }
+
+    std::vector<float>        distance; //< along the ray. maxDist on a miss
+    std::vector<float>        texU;     //< see RayHit::texU
+    std::vector<RayHit::Side> side;     //< NULLSIDE on a miss
+    std::vector<int32_t>      cellX;    //< -1 on a miss
+    std::vector<int32_t>      cellY;    //< -1 on a miss
+};
+
+inline void castColumnRaysScalar(const SolidGridView& grid,
+                                 float                originX,
+                                 float                originY,
+                                 const float*         dirX,
+                                 const float*         dirY,
+                                 size_t               begin,
+                                 size_t               end,
+                                 float                maxDist,
+                                 ColumnHits&          out) {
+    for (size_t i = begin; i < end; ++i) {
+        out.set(i,
+                castRay(originX,
+                        originY,
+                        dirX[i],
+                        dirY[i],
+                        maxDist,
+                        int64_t(grid.width),
+                        int64_t(grid.height),
+                        [&grid](size_t x, size_t y) { return grid.isSolid(x, y); }));
+    }
+}
+
+#if GJ_SIMD_X86
+
+/// \return number of columns traced. The remaining (count % 4) are left to the caller
+GJ_TARGET_SSE41 inline size_t castColumnRaysSSE41(const SolidGridView& grid,
+                                                  float                originX,
+                                                  float                originY,
+                                                  const float*         dirX,
+                                                  const float*         dirY,
+                                                  size_t               count,
+                                                  float                maxDist,
+                                                  ColumnHits&          out) {
+    const uint32_t* words32     = reinterpret_cast<const uint32_t*>(grid.words); //< little endian: 2 halves per word
+    const __m128    ox          = _mm_set1_ps(originX);
+    const __m128    oy          = _mm_set1_ps(originY);
+    const __m128    vMaxDist    = _mm_set1_ps(maxDist);
+    const __m128    one         = _mm_set1_ps(1.f);
+    const __m128    absMask     = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128i   width       = _mm_set1_epi32(int32_t(grid.width));
+    const __m128i   height      = _mm_set1_epi32(int32_t(grid.height));
+    const __m128i   minusOne    = _mm_set1_epi32(-1);
+    const __m128i   sideEW      = _mm_set1_epi32(RayHit::EAST_WEST);
+    const __m128i   sideNS      = _mm_set1_epi32(RayHit::NORTH_SOUTH);
+    const float     cellOriginX = std::floor(originX);
+    const float     cellOriginY = std::floor(originY);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 dx = _mm_loadu_ps(dirX + i);
+        const __m128 dy = _mm_loadu_ps(dirY + i);
+
+        __m128i mapX = _mm_set1_epi32(int32_t(cellOriginX));
+        __m128i mapY = _mm_set1_epi32(int32_t(cellOriginY));
+
+        const __m128 deltaX = _mm_and_ps(_mm_div_ps(one, dx), absMask); //< 1/0 = inf, as in castRay
+        const __m128 deltaY = _mm_and_ps(_mm_div_ps(one, dy), absMask);
+
+        const __m128 negX = _mm_cmplt_ps(dx, _mm_setzero_ps());
+        const __m128 negY = _mm_cmplt_ps(dy, _mm_setzero_ps());
+
+        const __m128i stepX = _mm_or_si128(_mm_castps_si128(negX), _mm_set1_epi32(1)); //< -1 or 1
+        const __m128i stepY = _mm_or_si128(_mm_castps_si128(negY), _mm_set1_epi32(1));
+
+        const __m128 fracX     = _mm_sub_ps(ox, _mm_set1_ps(cellOriginX));
+        const __m128 fracY     = _mm_sub_ps(oy, _mm_set1_ps(cellOriginY));
+        __m128       sideDistX = _mm_mul_ps(_mm_blendv_ps(_mm_sub_ps(one, fracX), fracX, negX), deltaX);
+        __m128       sideDistY = _mm_mul_ps(_mm_blendv_ps(_mm_sub_ps(one, fracY), fracY, negY), deltaY);
+
+        __m128  active   = _mm_castsi128_ps(minusOne);
+        __m128  distance = vMaxDist;
+        __m128i side     = _mm_setzero_si128(); //< NULLSIDE
+        __m128i cellX    = minusOne;
+        __m128i cellY    = minusOne;
+
+        while (_mm_movemask_ps(active)) {
+            const __m128 stepsX = _mm_cmplt_ps(sideDistX, sideDistY);
+            const __m128 t      = _mm_blendv_ps(sideDistY, sideDistX, stepsX);
+
+            sideDistX = _mm_add_ps(sideDistX, _mm_and_ps(deltaX, stepsX));
+            sideDistY = _mm_add_ps(sideDistY, _mm_andnot_ps(stepsX, deltaY));
+            mapX      = _mm_add_epi32(mapX, _mm_and_si128(stepX, _mm_castps_si128(stepsX)));
+            mapY      = _mm_add_epi32(mapY, _mm_andnot_si128(_mm_castps_si128(stepsX), stepY));
+
+            active = _mm_and_ps(active, _mm_cmple_ps(t, vMaxDist)); //< also drops NaN lanes
+
+            const __m128i inBounds = _mm_and_si128(
+                _mm_cmpgt_epi32(width, mapX),
+                _mm_and_si128(_mm_cmpgt_epi32(height, mapY),
+                              _mm_cmpgt_epi32(_mm_or_si128(mapX, mapY), minusOne))); //< both non-negative
+            const __m128 check = _mm_and_ps(active, _mm_castsi128_ps(inBounds));
+
+            const int checkBits = _mm_movemask_ps(check);
+            if (!checkBits) {
+                continue;
+            }
+
+            // no gather before AVX2: look the candidate cells up one by one
+            alignas(16) int32_t x[4], y[4], solid[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(x), mapX);
+            _mm_store_si128(reinterpret_cast<__m128i*>(y), mapY);
+            for (int lane = 0; lane < 4; ++lane) {
+                solid[lane] = 0;
+                if (checkBits & (1 << lane)) {
+                    uint32_t word = words32[size_t(y[lane]) * grid.wordsPerRow * 2 + size_t(x[lane] >> 5)];
+                    solid[lane]   = -int32_t((word >> (x[lane] & 31)) & 1);
+                }
+            }
+            const __m128 hit = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(solid)));
+
+            distance = _mm_blendv_ps(distance, t, hit);
+            side     = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(side),
+                                                  _mm_blendv_ps(_mm_castsi128_ps(sideNS), _mm_castsi128_ps(sideEW), stepsX),
+                                                  hit));
+            cellX    = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(cellX), _mm_castsi128_ps(mapX), hit));
+            cellY    = _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(cellY), _mm_castsi128_ps(mapY), hit));
+            active   = _mm_andnot_ps(hit, active);
+        }
+
+        // texU: fractional part of the hit point along the face, 0 on a miss as in castRay
+        const __m128 hitX   = _mm_add_ps(ox, _mm_mul_ps(distance, dx));
+        const __m128 hitY   = _mm_add_ps(oy, _mm_mul_ps(distance, dy));
+        const __m128 isEW   = _mm_castsi128_ps(_mm_cmpeq_epi32(side, sideEW));
+        const __m128 isMiss = _mm_castsi128_ps(_mm_cmpeq_epi32(side, _mm_setzero_si128()));
+        const __m128 along  = _mm_blendv_ps(hitX, hitY, isEW);
+        _mm_storeu_ps(out.texU.data() + i, _mm_andnot_ps(isMiss, _mm_sub_ps(along, _mm_floor_ps(along))));
+
+        _mm_storeu_ps(out.distance.data() + i, distance);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out.cellX.data() + i), cellX);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out.cellY.data() + i), cellY);
+        alignas(16) int32_t sides[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(sides), side);
+        for (int lane = 0; lane < 4; ++lane) {
+            out.side[i + lane] = RayHit::Side(sides[lane]);
+        }
+    }
+    return i;
+}
+
+/// \return number of columns traced. The remaining (count % 8) are left to the caller
+GJ_TARGET_AVX2 GJ_NO_FP_CONTRACT inline size_t castColumnRaysAVX2(const SolidGridView& grid,
+                                                                  float                originX,
+                                                                  float                originY,
+                                                                  const float*         dirX,
+                                                                  const float*         dirY,
+                                                                  size_t               count,
+                                                                  float                maxDist,
+                                                                  ColumnHits&          out) {
+    const int*    words32      = reinterpret_cast<const int*>(grid.words); //< little endian: 2 halves per word
+    const __m256  ox           = _mm256_set1_ps(originX);
+    const __m256  oy           = _mm256_set1_ps(originY);
+    const __m256  vMaxDist     = _mm256_set1_ps(maxDist);
+    const __m256  one          = _mm256_set1_ps(1.f);
+    const __m256  absMask      = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256i width        = _mm256_set1_epi32(int32_t(grid.width));
+    const __m256i height       = _mm256_set1_epi32(int32_t(grid.height));
+    const __m256i wordsPerRow2 = _mm256_set1_epi32(int32_t(grid.wordsPerRow * 2));
+    const __m256i minusOne     = _mm256_set1_epi32(-1);
+    const __m256i bitOne       = _mm256_set1_epi32(1);
+    const __m256i sideEW       = _mm256_set1_epi32(RayHit::EAST_WEST);
+    const __m256i sideNS       = _mm256_set1_epi32(RayHit::NORTH_SOUTH);
+    const float   cellOriginX  = std::floor(originX);
+    const float   cellOriginY  = std::floor(originY);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 dx = _mm256_loadu_ps(dirX + i);
+        const __m256 dy = _mm256_loadu_ps(dirY + i);
+
+        __m256i mapX = _mm256_set1_epi32(int32_t(cellOriginX));
+        __m256i mapY = _mm256_set1_epi32(int32_t(cellOriginY));
+
+        const __m256 deltaX = _mm256_and_ps(_mm256_div_ps(one, dx), absMask); //< 1/0 = inf, as in castRay
+        const __m256 deltaY = _mm256_and_ps(_mm256_div_ps(one, dy), absMask);
+
+        const __m256 negX = _mm256_cmp_ps(dx, _mm256_setzero_ps(), _CMP_LT_OQ);
+        const __m256 negY = _mm256_cmp_ps(dy, _mm256_setzero_ps(), _CMP_LT_OQ);
+
+        const __m256i stepX = _mm256_or_si256(_mm256_castps_si256(negX), bitOne); //< -1 or 1
+        const __m256i stepY = _mm256_or_si256(_mm256_castps_si256(negY), bitOne);
+
+        const __m256 fracX     = _mm256_sub_ps(ox, _mm256_set1_ps(cellOriginX));
+        const __m256 fracY     = _mm256_sub_ps(oy, _mm256_set1_ps(cellOriginY));
+        __m256       sideDistX = _mm256_mul_ps(_mm256_blendv_ps(_mm256_sub_ps(one, fracX), fracX, negX), deltaX);
+        __m256       sideDistY = _mm256_mul_ps(_mm256_blendv_ps(_mm256_sub_ps(one, fracY), fracY, negY), deltaY);
+
+        __m256  active   = _mm256_castsi256_ps(minusOne);
+        __m256  distance = vMaxDist;
+        __m256i side     = _mm256_setzero_si256(); //< NULLSIDE
+        __m256i cellX    = minusOne;
+        __m256i cellY    = minusOne;
+
+        while (_mm256_movemask_ps(active)) {
+            const __m256 stepsX = _mm256_cmp_ps(sideDistX, sideDistY, _CMP_LT_OQ);
+            const __m256 t      = _mm256_blendv_ps(sideDistY, sideDistX, stepsX);
+
+            sideDistX = _mm256_add_ps(sideDistX, _mm256_and_ps(deltaX, stepsX));
+            sideDistY = _mm256_add_ps(sideDistY, _mm256_andnot_ps(stepsX, deltaY));
+            mapX      = _mm256_add_epi32(mapX, _mm256_and_si256(stepX, _mm256_castps_si256(stepsX)));
+            mapY      = _mm256_add_epi32(mapY, _mm256_andnot_si256(_mm256_castps_si256(stepsX), stepY));
+
+            active = _mm256_and_ps(active, _mm256_cmp_ps(t, vMaxDist, _CMP_LE_OQ)); //< also drops NaN lanes
+
+            const __m256i inBounds = _mm256_and_si256(
+                _mm256_cmpgt_epi32(width, mapX),
+                _mm256_and_si256(_mm256_cmpgt_epi32(height, mapY),
+                                 _mm256_cmpgt_epi32(_mm256_or_si256(mapX, mapY), minusOne))); //< both non-negative
+            const __m256 check = _mm256_and_ps(active, _mm256_castsi256_ps(inBounds));
+            if (!_mm256_movemask_ps(check)) {
+                continue;
+            }
+
+            // gather the 32-bit half-word holding each lane's cell; masked-off lanes are not read
+            const __m256i index =
+                _mm256_add_epi32(_mm256_mullo_epi32(mapY, wordsPerRow2), _mm256_srli_epi32(mapX, 5));
+            const __m256i words =
+                _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), words32, index, _mm256_castps_si256(check), 4);
+            const __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(mapX, _mm256_set1_epi32(31))),
+                                                 bitOne);
+            const __m256  hit = _mm256_and_ps(check, _mm256_castsi256_ps(_mm256_cmpeq_epi32(bit, bitOne)));
+
+            distance = _mm256_blendv_ps(distance, t, hit);
+            side     = _mm256_castps_si256(
+                _mm256_blendv_ps(_mm256_castsi256_ps(side),
+                                 _mm256_blendv_ps(_mm256_castsi256_ps(sideNS), _mm256_castsi256_ps(sideEW), stepsX),
+                                 hit));
+            cellX    = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(cellX), _mm256_castsi256_ps(mapX), hit));
+            cellY    = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(cellY), _mm256_castsi256_ps(mapY), hit));
+            active   = _mm256_andnot_ps(hit, active);
+        }
+
+        // texU: fractional part of the hit point along the face, 0 on a miss as in castRay. mul + add, not an FMA: the
+        // same rounding as wallTexU
+        const __m256 hitX   = _mm256_add_ps(ox, _mm256_mul_ps(distance, dx));
+        const __m256 hitY   = _mm256_add_ps(oy, _mm256_mul_ps(distance, dy));
+        const __m256 isEW   = _mm256_castsi256_ps(_mm256_cmpeq_epi32(side, sideEW));
+        const __m256 isMiss = _mm256_castsi256_ps(_mm256_cmpeq_epi32(side, _mm256_setzero_si256()));
+        const __m256 along  = _mm256_blendv_ps(hitX, hitY, isEW);
+        _mm256_storeu_ps(out.texU.data() + i, _mm256_andnot_ps(isMiss, _mm256_sub_ps(along, _mm256_floor_ps(along))));
+
+        _mm256_storeu_ps(out.distance.data() + i, distance);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.cellX.data() + i), cellX);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.cellY.data() + i), cellY);
+        alignas(32) int32_t sides[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(sides), side);
+        for (int lane = 0; lane < 8; ++lane) {
+            out.side[i + lane] = RayHit::Side(sides[lane]);
+        }
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+#endif // GJ_SIMD_X86
+
+/// Casts one ray per column through `grid` with the widest packet width the CPU supports.
+/// \param dirX, dirY normalized world-space directions of `count` columns
+inline void castColumnRays(const SolidGridView& grid,
+                           float                originX,
+                           float                originY,
+                           const float*         dirX,
+                           const float*         dirY,
+                           size_t               count,
+                           float                maxDist,
+                           ColumnHits&          out,
+                           SimdLevel            simdLevel = getSimdLevel()) {
+    out.resize(count);
+    size_t done = 0;
+#if GJ_SIMD_X86
+    if (simdLevel == SimdLevel::AVX2) {
+        done = castColumnRaysAVX2(grid, originX, originY, dirX, dirY, count, maxDist, out);
+    } else if (simdLevel == SimdLevel::SSE41) {
+        done = castColumnRaysSSE41(grid, originX, originY, dirX, dirY, count, maxDist, out);
+    }
+#endif
+    castColumnRaysScalar(grid, originX, originY, dirX, dirY, done, count, maxDist, out);
+}
+
+/// Everything the wall trace of a frame depends on.
+struct ColumnTraceKey {
+    float           originX;
+    float           originY;
+    float           angle;              //< camera direction, radians
+    float           imagePlaneDistance; //< see ColumnRayTable
+    uint32_t        width;
+    float           maxDist;
+    const uint64_t* grid; //< SolidGridView::words
+
+    bool operator==(const ColumnTraceKey&) const = default;
+};
+
+/// Horizontal level of detail of the wall trace. A full trace first traces every step-th column, then fills each
+/// column between two traced ones from them if both hit one face of the same tile or of two adjacent tiles (so the
+/// face is solid all the way between them), at least minDistance away and within `tolerance` of each other's distance.
+/// Columns between any other pair are traced as well. Open rooms then trace a fraction of their columns, while near
+/// walls, edges and corners are traced as before. An occluder narrow enough to slip between two traced columns that hit
+/// the same face is missed; the distance limits keep that to small gaps far away.
+struct ColumnLod {
+    uint32_t step        = 1;   //< 1 traces every column
+    float    minDistance = 0.f; //< perpendicular, world units
+    float    tolerance   = 0.f; //< fraction of the nearer distance
+};
+
+/// Reuses the previous frame's wall trace. With an unchanged camera nothing is traced. When the camera only rotated,
+/// every column looks up the previously traced ray nearest to its own direction and reuses its hit if it is less than
+/// half a column away, and if that ray and the one on the column's other side hit the same face of the same tile (or
+/// both hit nothing). Only the newly exposed columns, and those at silhouettes, corners and tile edges, are traced.
+/// A reused hit is then on the tile and face the column's own ray hits, short of an occluder narrower than the gap
+/// between the two rays. Its distance and texU are those of a ray up to half a column off: the hit point moves along
+/// the face by up to half a column's width at that distance, divided by the cosine of the angle between the ray and the
+/// face's normal, so the error grows on faces seen at a grazing angle. Reused hits remember the direction they were
+/// really traced with, so errors do not pile up over successive frames.
+class ColumnHitCache {
+public:
+    /// \param dirX, dirY this frame's column directions, rotated from `rays`
+    /// \return number of columns traced
+    size_t update(const SolidGridView&  grid,
+                  const ColumnTraceKey& key,
+                  const ColumnRayTable& rays,
+                  const float*          dirX,
+                  const float*          dirY,
+                  SimdLevel             simdLevel = getSimdLevel()) {
+        if (valid && key == previousKey) {
+            return 0;
+        }
+        const size_t width = key.width;
+        const bool   sameView =
+            valid && key.width == previousKey.width && key.imagePlaneDistance == previousKey.imagePlaneDistance;
+        if (!sameView) {
+            rebuildColumnAngles(rays);
+        }
+
+        ColumnTraceKey rotated = previousKey;
+        rotated.angle          = key.angle;
+        if (!sameView || !(rotated == key)) {
+            const size_t traced = traceAll(grid, key, rays, dirX, dirY, simdLevel);
+            tracedAngle         = columnAngle;
+            return finish(key, traced);
+        }
+
+        // angles relative to the previous camera direction
+        const float delta = std::remainder(key.angle - previousKey.angle, 2.f * std::numbers::pi_v<float>);
+
+        std::swap(hits, previousHits);
+        hits.resize(width);
+        nextTracedAngle.resize(width);
+        missColumns.clear();
+        size_t j = 0;
+        for (size_t x = 0; x < width; ++x) {
+            const float target = columnAngle[x] + delta;
+            while (j + 1 < width && std::abs(tracedAngle[j + 1] - target) <= std::abs(tracedAngle[j] - target)) {
+                ++j;
+            }
+            // the previous ray on the column's other side, so the two bracket its direction
+            const size_t k = tracedAngle[j] < target ? std::min(j + 1, width - 1) : (j > 0 ? j - 1 : 0);
+            if (std::abs(tracedAngle[j] - target) <= halfSpacing[x] && k != j && seeSameFace(previousHits, j, k)) {
+                hits.set(x, previousHits.get(j));
+                nextTracedAngle[x] = tracedAngle[j] - delta;
+            } else {
+                missColumns.push_back(uint32_t(x));
+                nextTracedAngle[x] = columnAngle[x];
+            }
+        }
+        std::swap(tracedAngle, nextTracedAngle);
+        traceColumns(grid, key, missColumns, dirX, dirY, simdLevel);
+        return finish(key, missColumns.size());
+    }
+
+    const ColumnHits& getHits() const { return hits; }
+
+    /// Forces a full trace on the next update, e.g. after the tile grid changed in place.
+    void invalidate() { valid = false; }
+
+    /// Applies from the next full trace on, see ColumnLod
+    void setLod(const ColumnLod& _lod) {
+        lod = _lod;
+        invalidate();
+    }
+
+private:
+    /// Every column of this frame, see ColumnLod. \return number of columns traced
+    size_t traceAll(const SolidGridView&  grid,
+                    const ColumnTraceKey& key,
+                    const ColumnRayTable& rays,
+                    const float*          dirX,
+                    const float*          dirY,
+                    SimdLevel             simdLevel) {
+        const uint32_t width = key.width;
+        if (lod.step <= 1 || width <= lod.step) {
+            castColumnRays(grid, key.originX, key.originY, dirX, dirY, width, key.maxDist, hits, simdLevel);
+            return width;
+        }
+
+        hits.resize(width);
+        coarseColumns.clear();
+        for (uint32_t x = 0; x < width; x += lod.step) {
+            coarseColumns.push_back(x);
+        }
+        if (coarseColumns.back() != width - 1) {
+            coarseColumns.push_back(width - 1);
+        }
+        traceColumns(grid, key, coarseColumns, dirX, dirY, simdLevel);
+
+        missColumns.clear();
+        for (size_t i = 0; i + 1 < coarseColumns.size(); ++i) {
+            const uint32_t a = coarseColumns[i];
+            const uint32_t b = coarseColumns[i + 1];
+            if (canInterpolate(a, b, rays.fixPersp.data())) {
+                interpolate(a, b, key, rays.fixPersp.data(), dirX, dirY);
+            } else {
+                for (uint32_t x = a + 1; x < b; ++x) {
+                    missColumns.push_back(x);
+                }
+            }
+        }
+        traceColumns(grid, key, missColumns, dirX, dirY, simdLevel);
+        return coarseColumns.size() + missColumns.size();
+    }
+
+    /// \param fixPersp per column, see ColumnRayTable
+    bool canInterpolate(uint32_t a, uint32_t b, const float* fixPersp) const {
+        const RayHit::Side side = hits.side[a];
+        if (side == RayHit::NULLSIDE || side != hits.side[b]) {
+            return false;
+        }
+        // the face's line, and the tiles along it
+        const bool sameLine = side == RayHit::EAST_WEST ? hits.cellX[a] == hits.cellX[b] : hits.cellY[a] == hits.cellY[b];
+        if (!sameLine || std::abs(getAlongCell(a) - getAlongCell(b)) > 1) {
+            return false;
+        }
+        const float nearA  = hits.distance[a] * fixPersp[a];
+        const float nearB  = hits.distance[b] * fixPersp[b];
+        const float nearer = std::min(nearA, nearB);
+        return nearer >= lod.minDistance && std::abs(nearA - nearB) <= lod.tolerance * nearer;
+    }
+
+    /// Hits a and b are on the same face of the same tile, or both missed
+    static bool seeSameFace(const ColumnHits& h, size_t a, size_t b) {
+        return h.side[a] == h.side[b] && h.cellX[a] == h.cellX[b] && h.cellY[a] == h.cellY[b];
+    }
+
+    /// Cell coordinate of hit i along its face, see wallTexU
+    int32_t getAlongCell(uint32_t i) const { return hits.side[i] == RayHit::EAST_WEST ? hits.cellY[i] : hits.cellX[i]; }
+
+    /// Columns (a, b) from the hits of a and b on one face. A plane's 1 / distance and position / distance are linear in
+    /// the image plane coordinate, which is linear in x, so the interpolation is perspective correct.
+    /// \param dirX, dirY of every column, see update
+    void interpolate(uint32_t              a,
+                     uint32_t              b,
+                     const ColumnTraceKey& key,
+                     const float*          fixPersp,
+                     const float*          dirX,
+                     const float*          dirY) {
+        // world position along the face, as wallTexU has it: hits on a tile's far edge have texU 0 but still that tile
+        auto getAlong = [&](uint32_t i) {
+            return hits.side[i] == RayHit::EAST_WEST ? key.originY + hits.distance[i] * dirY[i]
+                                                     : key.originX + hits.distance[i] * dirX[i];
+        };
+        const RayHit::Side side     = hits.side[a];
+        const float        invA     = 1.f / (hits.distance[a] * fixPersp[a]);
+        const float        invB     = 1.f / (hits.distance[b] * fixPersp[b]);
+        const float        alongA   = getAlong(a) * invA;
+        const float        alongB   = getAlong(b) * invB;
+        const int32_t      cellLo   = std::min(getAlongCell(a), getAlongCell(b));
+        const int32_t      cellHi   = std::max(getAlongCell(a), getAlongCell(b));
+        const float        span     = float(b - a);
+        const float        maxTexU  = std::nextafter(1.f, 0.f);
+        for (uint32_t x = a + 1; x < b; ++x) {
+            const float   t     = float(x - a) / span;
+            const float   depth = 1.f / (invA + (invB - invA) * t);
+            const float   along = (alongA + (alongB - alongA) * t) * depth;
+            const int32_t cell  = std::clamp(int32_t(std::floor(along)), cellLo, cellHi); //< whatever the rounding
+            hits.distance[x]    = depth / fixPersp[x];
+            hits.texU[x]        = std::clamp(along - float(cell), 0.f, maxTexU);
+            hits.side[x]        = side;
+            hits.cellX[x]       = side == RayHit::EAST_WEST ? hits.cellX[a] : cell;
+            hits.cellY[x]       = side == RayHit::EAST_WEST ? cell : hits.cellY[a];
+        }
+    }
+
+    /// Traces `columns` of this frame as one packed batch into hits
+    void traceColumns(const SolidGridView&         grid,
+                      const ColumnTraceKey&        key,
+                      const std::vector<uint32_t>& columns,
+                      const float*                 dirX,
+                      const float*                 dirY,
+                      SimdLevel                    simdLevel) {
+        missDirX.resize(columns.size());
+        missDirY.resize(columns.size());
+        for (size_t i = 0; i < columns.size(); ++i) {
+            missDirX[i] = dirX[columns[i]];
+            missDirY[i] = dirY[columns[i]];
+        }
+        castColumnRays(grid,
+                       key.originX,
+                       key.originY,
+                       missDirX.data(),
+                       missDirY.data(),
+                       columns.size(),
+                       key.maxDist,
+                       missHits,
+                       simdLevel);
+        for (size_t i = 0; i < columns.size(); ++i) {
+            hits.set(columns[i], missHits.get(i));
+        }
+    }
+
+    size_t finish(const ColumnTraceKey& key, size_t traced) {
+        previousKey = key;
+        valid       = true;
+        return traced;
+    }
+
+    void rebuildColumnAngles(const ColumnRayTable& rays) {
+        const size_t width = rays.width;
+        columnAngle.resize(width);
+        halfSpacing.resize(width);
+        for (size_t x = 0; x < width; ++x) {
+            columnAngle[x] = std::atan2(rays.camY[x], rays.camX[x]);
+        }
+        for (size_t x = 0; x < width; ++x) {
+            const size_t prev = x > 0 ? x - 1 : x;
+            const size_t next = x + 1 < width ? x + 1 : x;
+            halfSpacing[x]    = 0.5f * (columnAngle[next] - columnAngle[prev]) / float(std::max<size_t>(1, next - prev));
+        }
+    }
+
+    bool                  valid = false;
+    ColumnTraceKey        previousKey{};
+    ColumnHits            hits;
+    ColumnHits            previousHits;    //< scratch, last frame's hits while rotating
+    std::vector<float>    columnAngle;     //< camera space angle of every column
+    std::vector<float>    halfSpacing;     //< half the angle between a column and its neighbours
+    std::vector<float>    tracedAngle;     //< per column, direction its hit was traced with, relative to previousKey.angle
+    std::vector<float>    nextTracedAngle; //< scratch
+    std::vector<uint32_t> missColumns;     //< columns without a reusable previous ray, or between LOD columns
+    std::vector<uint32_t> coarseColumns;   //< traced first, see ColumnLod
+    std::vector<float>    missDirX;
+    std::vector<float>    missDirY;
+    ColumnHits            missHits;
+    ColumnLod             lod;
+};
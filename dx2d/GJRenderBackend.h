@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#include "GJTexture.h"
+
+// Where GJRenderer puts the 2D parts of a frame (the 3D view's pixels, UI, minimap) and presents it. Free of DirectX /
+// Windows dependencies; see GJD2DBackend.h for the window and GJSoftwareBackend.h for headless runs.
+
+/// Straight alpha, [0..1] per channel
+struct ColorF {
+    float r;
+    float g;
+    float b;
+    float a = 1.f;
+};
+
+struct RectF {
+    float left;
+    float top;
+    float right;
+    float bottom;
+};
+
+struct SizeF {
+    float width;
+    float height;
+};
+
+/// HEADING and NORMAL are centered, SMALL is right aligned
+enum class TextFormat { HEADING = 0, NORMAL, SMALL, size };
+/// QLeap and Explode are loaded from files, Minimap is created and updated by the renderer
+enum class EGPUBitmap : size_t { QLeap = 0, Explode, Minimap, size };
+
+/// Frames are drawn into the low res target, which endFrame upscales into the window, letterboxed to a square. Draws
+/// into the window target keep its full resolution, under the low res target.
+enum class DrawTarget { LowRes, Window };
+
+/// Draw calls of a frame go between beginFrame and endFrame. Coordinates are pixels of the target drawn to.
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    /// Size of the low res target, fixed for the backend's lifetime
+    virtual uint32_t getWidth() const = 0;
+    virtual uint32_t getHeight() const = 0;
+
+    /// Clears the window to black and the low res target to transparent
+    virtual void beginFrame() = 0;
+    /// Upscales the low res target into the window and presents it
+    virtual void endFrame() = 0;
+    /// The last endFrame waited for vsync, so the frame rate needs no other pacing
+    virtual bool presentWaitedForVsync() const = 0;
+    /// Follows a change of the window's size
+    virtual void resize() = 0;
+
+    virtual void fillRectangle(const RectF& rect, ColorF color, DrawTarget target) = 0;
+    /// Into the low res target
+    virtual void drawLine(float x0, float y0, float x1, float y1, ColorF color, float strokeWidth) = 0;
+    /// \param layout box the text is wrapped and aligned in, see TextFormat
+    virtual void drawText(std::wstring_view text, TextFormat format, const RectF& layout, ColorF color, DrawTarget target) = 0;
+
+    /// Decodes an image file into 4 channel, straight alpha BGRA. \throws std::runtime_error if that fails
+    virtual CPUBitmap decodeImage(const std::filesystem::path& path) = 0;
+    /// Loads an image file for drawImage
+    virtual void loadImage(EGPUBitmap image, const std::filesystem::path& path) = 0;
+    /// Replaces `image` with `width` x `height` transparent pixels, to be filled by updateImage
+    virtual void createImage(EGPUBitmap image, uint32_t width, uint32_t height) = 0;
+    /// Copies rows [top, bottom) of `pixels`, premultiplied BGRA laid out like the image created by createImage, into
+    /// the same rows of `image`. Uploads only those rows, so images that change little stay cheap
+    virtual void updateImage(EGPUBitmap image, const uint32_t* pixels, uint32_t top, uint32_t bottom) = 0;
+    /// \return in pixels, of an image loaded with loadImage
+    virtual SizeF getImageSize(EGPUBitmap image) const = 0;
+    /// Draws all of a loaded image stretched over `dest` of the low res target, nearest neighbor
+    virtual void drawImage(EGPUBitmap image, const RectF& dest) = 0;
+
+    /// Uploads `width` x `height` packed BGRA pixels, at most the low res target's size, and draws them stretched over
+    /// `dest` of the low res target, nearest neighbor
+    virtual void drawPixels(const uint32_t* pixels, uint32_t width, uint32_t height, const RectF& dest) = 0;
+};
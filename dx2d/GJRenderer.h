@@ -1,210 +1,119 @@
 #pragma once
-#include <map>
+#include <algorithm>
 #include <string>
-#include <tchar.h>
 #include <chrono>
 #include <array>
+#include <atomic>
 #include <stdexcept>
-#include <format>
+#include <bit>
+#include <cassert>
+#include <barrier>
+#include <iostream>
+#include <memory>
+#include <thread>
 
-#include <DirectXMath.h>
-#include <DirectXCollision.h>
-#include <windows.h>
-#include <d2d1.h>
-#include <d2d1helper.h>
-#include <dwrite.h>
-#include <wrl/client.h>
-#include <wincodec.h>
+#include "GJVectorMath.h"
 
 #include "danny/cppUtil.h"
 #include "GJScene.h"
+#include "GJRaycastPacket.h"
+#include "GJRaster.h"
+#include "GJTexture.h"
+#include "GJSprites.h"
+#include "GJFloor.h"
+#include "GJInterlace.h"
+#include "GJMinimap.h"
+#include "GJPalette.h"
+#include "GJPipeline.h"
+#include "GJRenderBackend.h"
+#include "GJResolution.h"
+#include "GJSky.h"
+#include "GJWorkerPool.h"
+
+#ifndef OUT // windows.h annotates out parameters, elsewhere it is only a marker
+#define OUT
+#endif
 
 #define FMT_UNICODE 0 // https://github.com/gabime/spdlog/issues/3251
 #include "spdlog/spdlog.h"
 
-using Microsoft::WRL::ComPtr;
-constexpr bool DEBUG_FLOOR = false;
+constexpr bool DEBUG_FLOOR    = false;
+constexpr bool BENCH_RENDERER = false; //< time renderer hot paths with cppBench, printed on exit
+constexpr bool INDEXED_COLOR  = false; //< draw 8-bit palette indices, shaded by colormap lookups. See GJPalette.h
+constexpr bool INTERLACED     = false; //< draw every other column per frame, the rest comes from the last. See GJInterlace.h
+/// Threads drawing the 3D view, the render thread included. 0: one per hardware thread, minus the simulation thread's
+/// and one left to audio
+constexpr uint32_t RENDER_THREADS = 0;
+/// Wall trace level of detail: every 4th column first, columns between two far hits on one face are interpolated. See
+/// ColumnLod; { 1 } traces every column
+constexpr ColumnLod WALL_LOD = { 4, 6.f, 0.25f };
+/// Resolutions the 3D view may drop to, as fractions of the low res target, largest first. { 1.f } keeps it fixed
+constexpr std::array<float, 4> RESOLUTION_SCALES = { 1.f, 0.85f, 0.7f, 0.5f };
+/// drawScene time the resolution is adjusted to hold: half a 60 Hz frame, the rest goes to UI, present and simulation
+constexpr float SCENE_BUDGET_MS = 8.f;
+
+/// What the scene passes are compiled for, see GJRenderer::getScenePipeline. Per pixel and per column code tests these
+/// with `if constexpr`, so every pipeline runs only the work its features need.
+enum SceneFeature : uint32_t {
+    SCENE_INDEXED     = 1 << 0, //< INDEXED_COLOR
+    SCENE_DEBUG_FLOOR = 1 << 1, //< DEBUG_FLOOR
+    SCENE_CEILINGS    = 1 << 2, //< the map has ceilings, see TileMap::hasCeilings
+    SCENE_SEE_THROUGH = 1 << 3, //< the map has see-through tiles, see TileMap::hasSeeThrough
+    SCENE_INTERLACED  = 1 << 4, //< the frame draws only some columns, see Interlacer
+};
+/// Features set by the flags above, in every pipeline
+constexpr uint32_t SCENE_FIXED_FEATURES =
+    (INDEXED_COLOR ? SCENE_INDEXED : SceneFeature{}) | (DEBUG_FLOOR ? SCENE_DEBUG_FLOOR : SceneFeature{});
+/// Features picked per frame. Only these double the pipelines compiled: DEBUG_FLOOR draws no ceilings
+constexpr uint32_t SCENE_RUNTIME_FEATURES =
+    (DEBUG_FLOOR ? SceneFeature{} : SCENE_CEILINGS) | SCENE_SEE_THROUGH | (INTERLACED ? SCENE_INTERLACED : SceneFeature{});
 
 constexpr size_t toId(auto someEnum) {
     return static_cast<size_t>(someEnum);
 }
-enum class TextFormat { HEADING = 0, NORMAL, SMALL, size };
-enum class EGPUBitmap : size_t { QLeap = 0, Explode, size };
-
 enum class ECPUBitmap : size_t { Floor = 0, size };
 
-struct CPUBitmap {
-    size_t               width;
-    size_t               height;
-    uint8_t              channels;
-    std::vector<uint8_t> data;
-    size_t               getPixel(size_t x, size_t y) { return (y * width + x) * channels; }
+constexpr uint16_t ENTITY_SPRITE_TEXTURE   = 56; //< assets/textures/<id>.png
+constexpr uint16_t OBSTACLE_SPRITE_TEXTURE = 45;
+
+/// Times the enclosing scope with cppBench if BENCH_RENDERER is set, compiles to nothing otherwise.
+struct RendererBench {
+    RendererBench(const char* name) {
+        if constexpr (BENCH_RENDERER) {
+            id = cppBench(name);
+        }
+    }
+    ~RendererBench() {
+        if constexpr (BENCH_RENDERER) {
+            cppBenchEnd(id);
+        }
+    }
+    BenchId id = 0;
 };
+
 class GJRenderer {
 public:
-    GJRenderer(HWND hWnd, const GameplayState* gameplayState, const GJScene* scene)
-        : hWnd(hWnd)
-        , scene(scene)
-        , gameplayState(gameplayState) {
-
-        // Create WIC Factory
-        HRESULT hr =
-            CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(pWICFactory.GetAddressOf()));
-        checkFailed(hr, hWnd, "CoCreateInstance failed");
-
-
-        hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, pFactory.GetAddressOf());
-        checkFailed(hr, hWnd, "CreateFactory");
-
-
-        // Get the size of the client area
-        {
-            RECT clientRect; //< actual window size
-            GetClientRect(hWnd, &clientRect);
-            ASSERT_EXPR(clientRect.left == 0, "API promises this, but we do a sanity check");
-            ASSERT_EXPR(clientRect.top == 0);
-
-            hr = pFactory->CreateHwndRenderTarget(D2D1::RenderTargetProperties(),
-                                                  D2D1::HwndRenderTargetProperties(hWnd,
-                                                                                   D2D1::SizeU(clientRect.right,
-                                                                                               clientRect.bottom)),
-                                                  pRenderTarget.GetAddressOf());
-            checkFailed(hr, hWnd, "createHwndRenderTarget failed");
-
-            constexpr int UPSCALE_FACTOR = 2;
-            viewportWidth                = clientRect.right / UPSCALE_FACTOR;
-            viewportHeight               = clientRect.bottom / UPSCALE_FACTOR;
-
-            // todo delete these lines?
-            // float maxSide = std::max(float(viewportWidth), float(viewportHeight));
-            // float minSide = std::min(float(viewportWidth), float(viewportHeight));
-
-            // float offsetF = (maxSide - minSide) / 2.f;
-            // D2D1::Matrix3x2F translation = D2D1::Matrix3x2F::Translation(
-            //	offsetF, // X offset
-            //	0.f	     // Y offset
-            //);
-            // clientRect.right = minSide;
-            // clientRect.bottom = minSide;
-
-            // D2D1::Matrix3x2F transform = translation;
-
-            // pRenderTarget->SetTransform(transform);
-        }
-        // Make viewport square:
-        viewportWidth  = std::min(viewportWidth, viewportHeight);
-        viewportHeight = std::min(viewportWidth, viewportHeight);
-
-        // Create a compatible render target for low-res drawing
-        hr = pRenderTarget->CreateCompatibleRenderTarget(D2D1::SizeF(toF(viewportWidth), toF(viewportHeight)),
-                                                         pLowResRenderTarget.GetAddressOf());
-        checkFailed(hr, hWnd, "createCompatibleRenderTarget failed");
-        // Setup transformations
-        // float scaleF = float(viewportWidth) / float(viewportHeight);
-        // D2D1::Matrix3x2F scale = D2D1::Matrix3x2F::Scale(
-        //	scaleF, scaleF,
-        //	D2D1::Point2F(0.f, 0.f)
-        //);
-
-        // v todo delete this comment:
-        // float offsetF = (float(viewportHeight) - scaleF * float(viewportWidth)) / 2.f;
-
-
-        // Disable anti-aliasing for pixelated look
-        pLowResRenderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
-        pRenderTarget->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
-
-        loadGPUBitmap(L"assets/qLeap.png", EGPUBitmap::QLeap);
-        loadGPUBitmap(L"assets/explode.png", EGPUBitmap::Explode);
+    /// \param backend draws the 2D parts of the frame and presents it, e.g. D2DBackend or SoftwareBackend
+    explicit GJRenderer(std::unique_ptr<RenderBackend> _backend)
+        : backend(std::move(_backend)) {
+        // Square low res target
+        viewportWidth     = backend->getWidth();
+        viewportHeight    = backend->getHeight();
+        maxViewportWidth  = viewportWidth;
+        maxViewportHeight = viewportHeight;
+
+        static_assert(toId(EGPUBitmap::size) == 3, "update bitmaps!"); //< Minimap is created by syncMinimap
+        backend->loadImage(EGPUBitmap::QLeap, L"assets/qLeap.png");
+        backend->loadImage(EGPUBitmap::Explode, L"assets/explode.png");
         initDrawBuffer(L"assets/textures/4.png");
-        if (toId(EGPUBitmap::size) != 2) {
-            MessageBox(NULL, L"update bitmaps!", L"Error", MB_OK);
+        loadWallTextures();
+        loadCeilingTextures();
+        loadSpriteTextures();
+        if constexpr (INDEXED_COLOR) {
+            initPalette();
         }
-
-        // Create a solid color brush
-        hr = pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF(0.1f, 0.1f, 0.1f)), &brush);
-        checkFailed(hr, hWnd, "createSolidColorBrush failed");
-
-        hr = pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF(0.1f, 0.1f, 0.1f)), &brushes["black"]);
-        checkFailed(hr, hWnd, "createSolidColorBrush failed");
-
-        hr = pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF(0.7f, 1.f, 0.7f)), &brushes["green"]);
-        checkFailed(hr, hWnd, "createSolidColorBrush failed");
-
-        hr = pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF(1.f, 1.f, 0.7f)), &brushes["amber"]);
-        checkFailed(hr, hWnd, "createSolidColorBrush failed");
-
-        // hr = pRenderTarget->CreateSolidColorBrush(
-        //	D2D1::ColorF(D2D1::ColorF(0.7f, 0.7f, 1.f)),
-        //	&brushes["blue"]
-        //);
-        hr = pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF(0.49f, 0.995f, 0.995f)), &brushes["blue"]);
-
-        checkFailed(hr, hWnd, "createSolidColorBrush failed");
-        hr = pRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF(1.f, 1.f, 1.f)), &brushes["white"]);
-        checkFailed(hr, hWnd, "createSolidColorBrush failed");
-
-
-        IDWriteFactory* pDWriteFactory = nullptr;
-        hr                             = DWriteCreateFactory(DWRITE_FACTORY_TYPE_SHARED,
-                                 __uuidof(IDWriteFactory),
-                                 reinterpret_cast<IUnknown**>(&pDWriteFactory));
-
-        ComPtr<IDWriteFontCollection> pFontCollection;
-        hr = pDWriteFactory->GetSystemFontCollection(&pFontCollection, FALSE);
-        checkFailed(hr, hWnd, "getSystemFontCollection failed");
-
-        // Find the font family by name
-        UINT32 index  = 0;
-        BOOL   exists = FALSE;
-        hr            = pFontCollection->FindFamilyName(fontName.c_str(), &index, &exists);
-        if (FAILED(hr) || !exists) {
-            MessageBox(NULL,
-                       L"Please, exit the game, install the 'pressStart2P.ttf font file in the game folder for the game to "
-                       L"render text properly",
-                       L"Error",
-                       MB_OK);
-            std::wcerr << L"FindFamilyName failed: " << hr << std::endl;
-        }
-        hr = pDWriteFactory->CreateTextFormat(fontName.c_str(), // Font family
-                                              nullptr,          // Font collection
-                                              DWRITE_FONT_WEIGHT_NORMAL,
-                                              DWRITE_FONT_STYLE_NORMAL,
-                                              DWRITE_FONT_STRETCH_NORMAL,
-                                              30.0f, // Font size
-                                              L"",   // Locale
-                                              &textFormats[static_cast<size_t>(TextFormat::HEADING)]);
-        hr = textFormats[static_cast<size_t>(TextFormat::HEADING)]->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
-        hr = textFormats[static_cast<size_t>(TextFormat::HEADING)]->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR);
-
-        hr = pDWriteFactory->CreateTextFormat(fontName.c_str(), // Font family
-                                              nullptr,          // Font collection
-                                              DWRITE_FONT_WEIGHT_NORMAL,
-                                              DWRITE_FONT_STYLE_NORMAL,
-                                              DWRITE_FONT_STRETCH_NORMAL,
-                                              16.0f, // Font size
-                                              L"",   // Locale
-                                              &textFormats[static_cast<size_t>(TextFormat::NORMAL)]);
-        hr = textFormats[static_cast<size_t>(TextFormat::NORMAL)]->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER);
-        hr = textFormats[static_cast<size_t>(TextFormat::NORMAL)]->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR);
-
-        hr = pDWriteFactory->CreateTextFormat(fontName.c_str(), // Font family
-                                              nullptr,          // Font collection
-                                              DWRITE_FONT_WEIGHT_NORMAL,
-                                              DWRITE_FONT_STYLE_NORMAL,
-                                              DWRITE_FONT_STRETCH_NORMAL,
-                                              12.0f, // Font size
-                                              L"",   // Locale
-                                              &textFormats[static_cast<size_t>(TextFormat::SMALL)]);
-        hr = textFormats[static_cast<size_t>(TextFormat::SMALL)]->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING);
-        hr = textFormats[static_cast<size_t>(TextFormat::SMALL)]->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_NEAR);
-
-
-        if constexpr (static_cast<size_t>(TextFormat::size) != 3) {
-            MessageBox(NULL, L"update textformat", L"Error", MB_OK);
-            exit(-1);
-        }
-
+        setRenderThreadCount(getConfiguredRenderThreads());
+        columnHitCache.setLod(WALL_LOD);
 
         // Setup Draw Call Table
         drawCallTable[static_cast<size_t>(State::INGAME)]   = &GJRenderer::drawINGAME;
@@ -218,55 +127,23 @@ public:
         }
     }
 
-    void draw() {
-        pRenderTarget->BeginDraw();
-        pLowResRenderTarget->BeginDraw();
-
-        pRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::Black));
-        pLowResRenderTarget->Clear(D2D1::ColorF(D2D1::ColorF::Black, 0.f));
+    /// Render thread only. `frameState` and `frameScene` must stay unchanged until draw returns
+    void draw(const GameplayState& frameState, const GJScene& frameScene) {
+        setFrame(frameState, frameScene);
+        if (resizeRequested.exchange(false)) {
+            backend->resize();
+        }
+        backend->beginFrame();
 
         // drawBorder();
         (this->*drawCallTable[static_cast<size_t>(gameplayState->state)])();
 
-        // draw low res rt to main rt
-        pLowResRenderTarget->EndDraw();
-
-        ID2D1Bitmap* pLowResBitmap = nullptr;
-        HRESULT      hr            = pLowResRenderTarget->GetBitmap(&pLowResBitmap);
-        checkFailed(hr, hWnd, "getBitmap failed");
-
-        // letterboxing:
-
-        RECT clientRect; //< actual window size
-        GetClientRect(hWnd, &clientRect);
-        ASSERT_EXPR(clientRect.top == 0 && clientRect.left == 0, "API promises this, but let's sanity check");
-        int clientW = clientRect.right;
-        int clientH = clientRect.bottom;
-
-        int squareSize = std::min(clientW, clientH);
-        int offsetX    = (clientW - squareSize) / 2;
-        int offsetY    = (clientH - squareSize) / 2;
-
-        D2D1_RECT_F destRect =
-            D2D1::RectF(float(offsetX), float(offsetY), float(offsetX + squareSize), float(offsetY + squareSize));
-
-        pRenderTarget->DrawBitmap(pLowResBitmap,                                   // The bitmap to draw
-                                  &destRect,                                       // Destination rectangle
-                                  1.0f,                                            // Opacity (1.0f = fully opaque)
-                                  D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, // Nearest-neighbor for pixelated scaling
-                                  NULL // Source rectangle (NULL to use the entire bitmap)
-        );
-        pLowResBitmap->Release();
-        hr = pRenderTarget->EndDraw();
-
-        if (hr == D2DERR_RECREATE_TARGET) {
-            assert(false); // this case has not been tested / implemented yet
-            throw std::runtime_error("D2DERR_RECREATE_TARGET");
-            // warning viewportWidth is already manilated here:
-            // init(hWnd, viewportWidth, viewportHeight, gameplayState);
-        }
+        backend->endFrame();
     }
 
+    /// Render thread only. See RenderBackend::presentWaitedForVsync
+    bool presentWaitedForVsync() const { return backend->presentWaitedForVsync(); }
+
     void drawINGAME() {
         drawScene();
         drawUI();
@@ -303,107 +180,47 @@ public:
     void drawInstructions() {
         std::wstring instructions = L"You are an electron, running along the path of least resistance. Do not hit the air "
                                     L"bubbles!\n\n[Q],[W],[A],[S]: Quantum Scatter\n[Space] Quantum Leap\n";
-        pRenderTarget->DrawText(instructions.c_str(), // Text to render
-                                toU32(wcslen(instructions.c_str())),
-                                textFormats[static_cast<size_t>(TextFormat::NORMAL)].Get(), // Text format
-                                D2D1::RectF(20, 20, 340, 340),                              // Layout rectangle
-                                brushes["white"].Get());
+        backend->drawText(instructions, TextFormat::NORMAL, { 20, 20, 340, 340 }, WHITE, DrawTarget::Window);
     }
 
     void drawMinimap() {
-        // draw minimap
-        float       size         = 2.f;
-        float       minimapAlpha = 0.7f;
-        D2D1_RECT_F pos          = D2D1::RectF(0, 0, 0, 0);
-        for (int y = 0; y < gameplayState->height; ++y) {
-            pos.top    = y * size;
-            pos.bottom = pos.top + size;
-            for (int x = 0; x < gameplayState->width; ++x) {
-                const char& tile = gameplayState->getTile(x, y);
-                if (tile == '#') {
-                    // brush->SetColor(D2D1_COLOR_F{});
-                    brush->SetColor(D2D1::ColorF(0.2f, 0.2f, 0.2f, minimapAlpha));
-                } else if (tile == ' ') {
-                    brush->SetColor(D2D1::ColorF{ 1.f, 1.f, 1.f, minimapAlpha });
-                } else {
-                    throw std::runtime_error("");
-                }
-                pos.left  = x * size;
-                pos.right = pos.left + size;
-
-                pLowResRenderTarget->FillRectangle(pos, brush.Get());
-            }
+        // draw minimap: the cached tile layer, one texel per tile
+        float size         = 2.f;
+        float minimapAlpha = 0.7f;
+        syncMinimap(minimapAlpha);
+        if (!minimap.empty()) {
+            const RectF tiles = { 0.f, 0.f, float(minimap.getWidth()) * size, float(minimap.getHeight()) * size };
+            backend->drawImage(EGPUBitmap::Minimap, tiles);
         }
 
         // draw entities on minimap
         XMVECTOR    posV  = size * XMVectorFloor(scene->camera.position);
         const float pos_x = XMVectorGetX(posV);
         const float pos_y = XMVectorGetY(posV);
-        pos               = D2D1::RectF(pos_x, pos_y, pos_x + size, pos_y + size);
-        brush->SetColor(D2D1::ColorF{ 1.f, 0.7f, 0.7f, minimapAlpha });
-        pLowResRenderTarget->FillRectangle(pos, brush.Get());
+        RectF       pos   = { pos_x, pos_y, pos_x + size, pos_y + size };
+        backend->fillRectangle(pos, { 1.f, 0.7f, 0.7f, minimapAlpha }, DrawTarget::LowRes);
 
         // v Draw LOS
-        brush->SetColor(D2D1::ColorF{ 1.f, 1.f, 0.7f, minimapAlpha });
         XMVECTOR    endV  = posV + scene->camera.getDirectionVector() * 20;
         const float end_x = XMVectorGetX(endV);
         const float end_y = XMVectorGetY(endV); //< '-' because screen-space is inverted
-        pLowResRenderTarget->DrawLine(D2D1_POINT_2F(pos_x, pos_y), D2D1_POINT_2F(end_x, end_y), brush.Get(), 1.f);
+        backend->drawLine(pos_x, pos_y, end_x, end_y, { 1.f, 1.f, 0.7f, minimapAlpha }, 1.f);
     }
 
-
-    struct IntersectionData {
-        enum Side {
-            NULLSIDE,
-            NORTH_SOUTH,
-            EAST_WEST,
-        };
-        float distance = 0;
-        // Texture texture = Texture::NO_TEXTURE
-        D2D1::ColorF solidColor = D2D1::ColorF{ 1.f, 1.f, 1.f, 1.f };
-        Side         side       = NULLSIDE;
-    };
-
-    IntersectionData::Side whichSideWasHit(const XMVECTOR& origin, const XMVECTOR& dir, const BoundingBox& b, float dist) const {
-        // * Determine which side was hit:
-        XMVECTOR P = origin + dist * dir;
-        // ** vector from box center to hit point
-        XMVECTOR boxCenterVector = XMVectorSet(b.Center.x, b.Center.y, b.Center.z, 0.f);
-        XMVECTOR d               = P - boxCenterVector;
-        float    dx              = XMVectorGetX(d);
-        float    dy              = XMVectorGetY(d);
-
-        if (std::abs(dy) > std::abs(dx)) {
-            return IntersectionData::NORTH_SOUTH;
-        } else {
-            return IntersectionData::EAST_WEST;
+    /// Brings the minimap's tile layer up to date with the map's solidity, and uploads only the rows that changed
+    void syncMinimap(float alpha) {
+        const MinimapUpdate update = minimap.sync(gameplayState->tiles.getSolidGrid(), alpha);
+        if (minimap.empty()) {
+            return;
         }
-    }
-
-    void intersect(const XMVECTOR& origin, const XMVECTOR& dir, IntersectionData& out) const {
-        BoundingBox bestBox;
-        float       bestDistance = FLT_MAX;
-
-        for (int y = 0; y < gameplayState->height; ++y) {
-            for (int x = 0; x < gameplayState->width; ++x) {
-                if (gameplayState->getTile(x, y) != '#') {
-                    continue;
-                }
-                BoundingBox b{ XMFLOAT3{ float(x) + 0.5f, float(y) + 0.5f, 0 }, XMFLOAT3{ 0.5, 0.5, 0 } };
-
-                float candidateDistance;
-                bool  intersects = b.Intersects(origin, dir, OUT candidateDistance);
-
-                if (intersects && bestDistance > candidateDistance) {
-                    bestDistance = candidateDistance;
-                    bestBox      = b;
-                }
-            }
+        if (update.resized) {
+            backend->createImage(EGPUBitmap::Minimap, uint32_t(minimap.getWidth()), uint32_t(minimap.getHeight()));
+        }
+        if (update.dirtyTop < update.dirtyEnd) {
+            backend->updateImage(EGPUBitmap::Minimap, minimap.getTexels(), update.dirtyTop, update.dirtyEnd);
         }
-        out.distance   = bestDistance;
-        out.solidColor = { 1.f, 1.f, 1.f, DEBUG_FLOOR ? 0.5f : 1.f };
-        out.side       = whichSideWasHit(origin, dir, bestBox, out.distance);
     }
+
     // v ABGR
     uint32_t sampleFloor(float x, float y) const {
         uint8_t c = toU8(std::floor(x)) + toU8(std::floor(y));
@@ -411,13 +228,13 @@ public:
         c *= 255;
 
 
-        if (DEBUG_FLOOR) {
+        if constexpr (DEBUG_FLOOR) {
             bool tileOutsideMap = x >= gameplayState->width || y >= gameplayState->height || x <= 0 || y <= 0;
             if (tileOutsideMap) {
                 return (0xFF << 24) | (c << 16) | (c << 8) | (c / 2);
             }
 
-            bool tileUnderWall = gameplayState->getTile(size_t(x), size_t(y)) == '#';
+            bool tileUnderWall = gameplayState->isSolid(size_t(x), size_t(y));
             if (tileUnderWall) {
                 return 0xFFAAAAFF;
             }
@@ -440,168 +257,524 @@ public:
     }
 
     template <typename T = int>
-    T HscrH() {
+    T HscrH() const {
         return T(viewportHeight) / T(2);
     }
 
     template <typename T = int>
-    T HscrW() {
+    T HscrW() const {
         return T(viewportWidth) / T(2);
     }
 
     // \return Could be negative
-    int getHorizon(float pitch) { return HscrH<int>() + int(-pitch * HscrH<float>()) - 1; }
+    int getHorizon(float pitch) const { return HscrH<int>() + int(-pitch * HscrH<float>()) - 1; }
+
+    struct WallSpan {
+        float top;
+        float bottom;
+    };
 
-    /// \param height in world units. \param color [0..1]
-    void drawWall(float x, float dist, float height, const D2D1::ColorF& color) {
+    /// \param dist perpendicular to the image plane. \param height in world units
+    WallSpan getWallSpan(float dist, float height) {
         const float& FOCAL_LENGTH = HscrH<float>();
         float        pixHeight    = (FOCAL_LENGTH * height) / dist;
-        brush->SetColor(color);
-        float pixBottom = getHorizon(scene->camera.pitch) + (FOCAL_LENGTH * (scene->camera.camHeight)) / dist;
-        pLowResRenderTarget->DrawLine(D2D1_POINT_2F(x, pixBottom), D2D1_POINT_2F(x, pixBottom - pixHeight), brush.Get(), 1.f);
+        float        pixBottom    = getHorizon(scene->camera.pitch) + (FOCAL_LENGTH * (scene->camera.camHeight)) / dist;
+        return { pixBottom - pixHeight, pixBottom };
     }
 
-    float sampleWall() {
-        ASSERT_EXPR(false, "not implemented");
-        return 0.f;
+    /// \param height in world units. \param color BGRA, see FrameView
+    template <uint32_t FEATURES>
+    void drawWall(uint32_t x, float dist, float height, uint32_t color) {
+        WallSpan span = getWallSpan(dist, height);
+        if constexpr (FEATURES & SCENE_INDEXED) {
+            // DEBUG_FLOOR's see-through walls need blending, which palette indices only do for textures
+            fillColumnSpan(getIndexBufferView(), x, span.top, span.bottom, palette.nearest(color));
+        } else if constexpr (FEATURES & SCENE_DEBUG_FLOOR) {
+            blendColumnSpan(getDrawBufferView(), x, span.top, span.bottom, color, 128);
+        } else {
+            fillColumnSpan(getDrawBufferView(), x, span.top, span.bottom, color);
+        }
     }
 
-    void drawWalls() {
-        XMVECTOR         dir;
-        IntersectionData intersection;
-        for (int x = 0; x < viewportWidth; ++x) {
-            float fixPersp = getPixelDir(x, OUT dir);
-            intersect(scene->camera.position, dir, OUT intersection);
+    /// \return the column of `level` of `texture` that a ray of screen column x hit, see TexelLayout::ColumnMajor
+    /// \param texU, side of the hit, see RayHit
+    /// \tparam Texel uint8_t for palette indexed textures, see CPUBitmap::indexColumn
+    template <typename Texel = uint32_t>
+    const Texel* sampleWall(const CPUBitmap& texture, size_t level, uint32_t x, float texU, RayHit::Side side) const {
+        const MipLevel mip = texture.getMip(level);
+        uint32_t       u   = std::min(uint32_t(texU * float(mip.width)), uint32_t(mip.width - 1));
+
+        // texU grows along +x / +y. Mirror faces seen from the other side so textures always read left to right:
+        if ((side == RayHit::EAST_WEST && columnDirX[x] < 0.f) || (side == RayHit::NORTH_SOUTH && columnDirY[x] > 0.f)) {
+            u = uint32_t(mip.width - 1) - u;
+        }
+        if constexpr (sizeof(Texel) == 1) {
+            return texture.indexColumn(u, level);
+        } else {
+            return texture.column(u, level);
+        }
+    }
 
-            // correct shade based on distance:
-            intersection.distance = std::clamp(intersection.distance, 0.f, MAXVIEWDIST);
+    /// Fills columnDirX/Y with this frame's world-space ray direction of every column
+    void updateColumnRays() {
+        const float imagePlaneDistance = scene->camera.getImagePlaneDistance(); // depends on field of view
+        if (!columnRays.isValidFor(imagePlaneDistance, viewportWidth)) {
+            columnRays.rebuild(imagePlaneDistance, viewportWidth);
+            columnDirX.resize(viewportWidth);
+            columnDirY.resize(viewportWidth);
+        }
 
-            auto&    c                      = intersection.solidColor;
-            XMVECTOR colorVector            = XMVectorSet(c.r, c.g, c.b, c.a);
-            XMVECTOR maxDistanceColorVector = XMVectorSet(c.r - 0.4f, c.g - 0.4f, c.b - 0.4f, c.a);
+        XMVECTOR camDir = scene->camera.getDirectionVector();
+        columnRays.rotate(XMVectorGetX(camDir), XMVectorGetY(camDir), columnDirX.data(), columnDirY.data());
+    }
+
+    /// Finds what every column sees. Runs before the sky and floor, so they can skip what walls will cover
+    void traceWalls() {
+        {
+            RendererBench bench("column setup (ColumnRayTable)");
+            updateColumnRays();
+        }
 
-            float    t           = intersection.distance / MAXVIEWDIST;
-            XMVECTOR shadeVector = XMVectorLerp(colorVector, maxDistanceColorVector, t);
+        {
+            // menus and idle players redraw the same view: most frames trace nothing or only the newly exposed columns
+            RendererBench       bench("wall trace");
+            const SolidGridView grid = gameplayState->tiles.getSolidGrid();
+            columnHitCache.update(grid,
+                                  { XMVectorGetX(scene->camera.position),
+                                    XMVectorGetY(scene->camera.position),
+                                    scene->camera.getDirectionAngle(),
+                                    columnRays.imagePlaneDistance,
+                                    viewportWidth,
+                                    MAXVIEWDIST,
+                                    grid.words },
+                                  columnRays,
+                                  columnDirX.data(),
+                                  columnDirY.data());
+        }
+    }
 
-            // correct shade based on wall side (normal direction)
-            if (intersection.side == IntersectionData::NORTH_SOUTH) {
-                shadeVector += XMVECTOR{ -0.15, -0.15, -0.15, 0 };
+    /// What a render thread needs to draw see-through columns, see drawWallLayers
+    struct WallLayerScratch {
+        RayHitStack      rayLayers;  //< hits of the see-through column being drawn
+        ColumnCompositor compositor; //< blends rayLayers into drawBuffer
+    };
+
+    /// Walls of `columns` in [xBegin, xEnd). Every column writes only its own pixels and depthBuffer entry.
+    template <uint32_t FEATURES>
+    void drawWalls(uint32_t xBegin, uint32_t xEnd, ColumnSet columns, WallLayerScratch& scratch) {
+        const ColumnHits& columnHits = columnHitCache.getHits();
+        columns                      = getDrawnColumns<FEATURES>(columns);
+        for (uint32_t x = columns.firstFrom(xBegin); x < xEnd; x += columns.step) {
+            float fixPersp = columnRays.fixPersp[x];
+            float distance = std::clamp(columnHits.distance[x], 0.f, MAXVIEWDIST);
+
+            const RayHit::Side side = columnHits.side[x];
+
+            depthBuffer[x] = distance * fixPersp;
+
+            if ((FEATURES & SCENE_DEBUG_FLOOR) || side == RayHit::NULLSIDE) {
+                // nothing hit within MAXVIEWDIST: flat shaded wall at the fog distance
+                drawWall<FEATURES>(x, distance * fixPersp, 1.f, getFogWallColor(distance, side));
+                continue;
             }
 
-            // clamp
-            shadeVector = XMVectorClamp(shadeVector, XMVECTOR{ 0.f, 0.f, 0.f, 0.f }, XMVECTOR{ 1.f, 1.f, 1.f, 1.f });
+            const TileAttributes& tile = gameplayState->getTile(size_t(columnHits.cellX[x]), size_t(columnHits.cellY[x]));
+            if constexpr (FEATURES & SCENE_SEE_THROUGH) {
+                if (tile.transparency > 0) {
+                    depthBuffer[x] = drawWallLayers<FEATURES>(x, scratch);
+                    continue;
+                }
+            }
+            const CPUBitmap& texture = getWallTexture(tile.textureId);
+
+            WallSpan span = getWallSpan(distance * fixPersp, tile.height / 255.f);
+
+            // far walls read a smaller mip, so the texels touched stay proportional to the pixels drawn
+            size_t level = texture.selectMip(float(texture.height) / (span.bottom - span.top));
+            if constexpr (FEATURES & SCENE_INDEXED) {
+                drawIndexedColumnSpan(getIndexBufferView(),
+                                      x,
+                                      span.top,
+                                      span.bottom,
+                                      sampleWall<uint8_t>(texture, level, x, columnHits.texU[x], side),
+                                      uint32_t(texture.getMip(level).height),
+                                      palette.getColormap(getLightLevel(getWallLight(distance, side))));
+            } else {
+                drawTexturedColumnSpan(getDrawBufferView(),
+                                       x,
+                                       span.top,
+                                       span.bottom,
+                                       sampleWall(texture, level, x, columnHits.texU[x], side),
+                                       uint32_t(texture.getMip(level).height),
+                                       getWallLight(distance, side));
+            }
+        }
+    }
 
-            // draw wall:
-            D2D1::ColorF shade{
-                XMVectorGetX(shadeVector), XMVectorGetY(shadeVector), XMVectorGetZ(shadeVector), XMVectorGetW(shadeVector)
-            };
+    /// Column x starts with a see-through tile: traces on behind it and composites every tile hit front to back, up to
+    /// the first opaque one.
+    /// \return perpendicular distance of the opaque tile ending the column, for the depth buffer. Sprites behind
+    /// see-through tiles are drawn on top of them
+    template <uint32_t FEATURES>
+    float drawWallLayers(uint32_t x, WallLayerScratch& scratch) {
+        RayHitStack&   rayLayers = scratch.rayLayers;
+        const TileMap& tiles     = gameplayState->tiles;
+        castRayLayers(XMVectorGetX(scene->camera.position),
+                      XMVectorGetY(scene->camera.position),
+                      columnDirX[x],
+                      columnDirY[x],
+                      MAXVIEWDIST,
+                      int64_t(tiles.getWidth()),
+                      int64_t(tiles.getHeight()),
+                      [&tiles](size_t cellX, size_t cellY) { return tiles.isSolid(cellX, cellY); },
+                      [&tiles](size_t cellX, size_t cellY) { return tiles.isSeeThrough(cellX, cellY); },
+                      OUT rayLayers);
+
+        const float fixPersp = columnRays.fixPersp[x];
+        float       depth    = MAXVIEWDIST * fixPersp;
+        if (rayLayers.opaque) {
+            depth = std::clamp(rayLayers.hits[rayLayers.count - 1].distance, 0.f, MAXVIEWDIST) * fixPersp;
+        }
+        if constexpr (FEATURES & SCENE_INDEXED) {
+            drawIndexedWallLayers(x, rayLayers);
+        } else {
+            ColumnCompositor& compositor = scratch.compositor;
+            compositor.begin(getDrawBufferView(), x);
+            for (const RayHit& hit : rayLayers) {
+                if (compositor.isOpaque()) {
+                    break;
+                }
+                const float           distance = std::clamp(hit.distance, 0.f, MAXVIEWDIST);
+                const TileAttributes& tile     = gameplayState->getTile(size_t(hit.cellX), size_t(hit.cellY));
+                const CPUBitmap&      texture  = wallTextures[tile.textureId];
+                const WallSpan        span     = getWallSpan(distance * fixPersp, tile.height / 255.f);
+                const size_t          level    = texture.selectMip(float(texture.height) / (span.bottom - span.top));
+                const uint32_t*       column   = sampleWall(texture, level, x, hit.texU, hit.side);
+                const uint32_t        texH     = uint32_t(texture.getMip(level).height);
+                const uint32_t        light    = getWallLight(distance, hit.side);
+                if (tile.transparency > 0) {
+                    compositor.addTexturedSpan<true>(span.top, span.bottom, column, texH, light, 256 - tile.transparency);
+                } else {
+                    compositor.addTexturedSpan<false>(span.top, span.bottom, column, texH, light, 256);
+                }
+            }
 
-            drawWall(x, intersection.distance * fixPersp, 1.f, shade);
+            if (!rayLayers.opaque && rayLayers.count < MAX_RAY_LAYERS) {
+                // seen through to MAXVIEWDIST: the fog wall, as for columns that hit nothing
+                const WallSpan span = getWallSpan(depth, 1.f);
+                compositor.addFilledSpan(span.top, span.bottom, getFogWallColor(MAXVIEWDIST, RayHit::NULLSIDE), 256);
+            }
+            compositor.resolve();
         }
+        return depth;
     }
 
-    void drawScene() {
-        // * mode7 & sky
-        updateDrawBuffer();
+    /// INDEXED_COLOR counterpart of the compositor in drawWallLayers: draws the layers back to front over the fog wall, if
+    /// the column sees through to it. Translucent tiles blend half over what lies behind them, see
+    /// Palette::getTranslucency; tiles that are nearly opaque only let their holes through.
+    void drawIndexedWallLayers(uint32_t x, const RayHitStack& rayLayers) {
+        const IndexedFrameView frame    = getIndexBufferView();
+        const float            fixPersp = columnRays.fixPersp[x];
+        if (!rayLayers.opaque && rayLayers.count < MAX_RAY_LAYERS) {
+            const WallSpan span = getWallSpan(MAXVIEWDIST * fixPersp, 1.f);
+            fillColumnSpan(frame, x, span.top, span.bottom, palette.nearest(getFogWallColor(MAXVIEWDIST, RayHit::NULLSIDE)));
+        }
+        for (uint32_t i = rayLayers.count; i-- > 0;) {
+            const RayHit&         hit      = rayLayers.hits[i];
+            const float           distance = std::clamp(hit.distance, 0.f, MAXVIEWDIST);
+            const TileAttributes& tile     = gameplayState->getTile(size_t(hit.cellX), size_t(hit.cellY));
+            const CPUBitmap&      texture  = getWallTexture(tile.textureId);
+            const WallSpan        span     = getWallSpan(distance * fixPersp, tile.height / 255.f);
+            const size_t          level    = texture.selectMip(float(texture.height) / (span.bottom - span.top));
+            const uint8_t*        column   = sampleWall<uint8_t>(texture, level, x, hit.texU, hit.side);
+            const uint32_t        texH     = uint32_t(texture.getMip(level).height);
+            const uint8_t*        colormap = palette.getColormap(getLightLevel(getWallLight(distance, hit.side)));
+            if (tile.transparency >= 64) {
+                drawIndexedColumnSpan<true>(frame, x, span.top, span.bottom, column, texH, colormap, palette.getTranslucency());
+            } else if (tile.transparency > 0) {
+                drawIndexedColumnSpan<true>(frame, x, span.top, span.bottom, column, texH, colormap);
+            } else {
+                drawIndexedColumnSpan<false>(frame, x, span.top, span.bottom, column, texH, colormap);
+            }
+        }
+    }
 
-        D2D1_RECT_U destRect = { 0U, 0U, viewportWidth, viewportHeight };
-        pFloorGPUBitmap->CopyFromMemory(&destRect, drawBuffer.data(), viewportWidth * sizeof(uint32_t));
+    /// Distance fog and side shading of a wall column. \return [0..256], see shadeBGRA
+    uint32_t getWallLight(float distance, RayHit::Side side) const {
+        float sideShade = side == RayHit::NORTH_SOUTH ? -0.15f : 0.f;
+        return uint32_t(std::clamp(1.f - 0.4f * distance / MAXVIEWDIST + sideShade, 0.f, 1.f) * 256.f);
+    }
+
+    /// Flat color of untextured wall columns, fogged and side shaded like getWallLight
+    uint32_t getFogWallColor(float distance, RayHit::Side side) const {
+        const ColorF       c         = { 1.f, 1.f, 1.f, 1.f };
+        float              sideShade = side == RayHit::NORTH_SOUTH ? -0.15f : 0.f;
+        float              fog       = -0.4f * distance / MAXVIEWDIST + sideShade;
+        return packBGRA(c.r + fog, c.g + fog, c.b + fog);
+    }
 
-        D2D1_SIZE_F bitmapSize = pFloorGPUBitmap->GetSize();
-        pLowResRenderTarget->DrawBitmap(pFloorGPUBitmap.Get(),
-                                        D2D1::RectF(0, 0, bitmapSize.width, bitmapSize.height),
-                                        1.0f, // Opacity (1.0f = fully opaque)
-                                        D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
-                                        nullptr // Source rectangle (nullptr to use entire bitmap)
-        );
+    /// Projects this frame's entities and obstacles, see drawSprites
+    void cullSprites() {
+        RendererBench bench("sprite culling");
 
-        // * walls
-        drawWalls();
+        sprites.clear();
+        for (const Entity& e : scene->entities) {
+            if (e.health > 0) {
+                sprites.push_back({ XMVectorGetX(e.position), XMVectorGetY(e.position), 1.f, 1.f, ENTITY_SPRITE_TEXTURE });
+            }
+        }
+        for (const Entity& o : scene->obstacles) {
+            if (o.health > 0) {
+                sprites.push_back({ XMVectorGetX(o.position), XMVectorGetY(o.position), 1.f, 1.f, OBSTACLE_SPRITE_TEXTURE });
+            }
+        }
+
+        XMVECTOR camDir = scene->camera.getDirectionVector();
+        spriteCuller.cull(sprites,
+                          { XMVectorGetX(scene->camera.position),
+                            XMVectorGetY(scene->camera.position),
+                            XMVectorGetX(camDir),
+                            XMVectorGetY(camDir),
+                            scene->camera.getImagePlaneDistance(),
+                            viewportWidth,
+                            0.1f,
+                            MAXVIEWDIST },
+                          STRIP_COLUMNS);
+    }
+
+    /// Billboards of cullSprites over `columns` in [xBegin, xEnd), back to front, clipped per column against the walls'
+    /// depthBuffer. [xBegin, xEnd) lies within one strip, so only the sprites binned for it are visited.
+    template <uint32_t FEATURES>
+    void drawSprites(uint32_t xBegin, uint32_t xEnd, ColumnSet columns) {
+        const FrameView frame = getDrawBufferView();
+        columns               = getDrawnColumns<FEATURES>(columns);
+        const uint32_t bin    = xBegin / STRIP_COLUMNS;
+        assert(xEnd <= (bin + 1) * STRIP_COLUMNS);
+        for (uint32_t visibleIndex : spriteCuller.getBin(bin)) {
+            const ProjectedSprite& p       = spriteCuller.getVisible()[visibleIndex];
+            const Sprite&          sprite  = sprites[p.index];
+            const CPUBitmap&       texture = (FEATURES & SCENE_INDEXED) ? indexedTextures.sprites[sprite.textureId]
+                                                                        : spriteTextures[sprite.textureId];
+            const size_t           level   = texture.selectMip(float(texture.width) / p.screenWidth);
+            const MipLevel         mip     = texture.getMip(level);
+            const WallSpan         span    = getWallSpan(p.depth, sprite.height);
+            const uint32_t         light   = uint32_t(std::clamp(1.f - 0.4f * p.depth / MAXVIEWDIST, 0.f, 1.f) * 256.f);
+
+            const SpriteColumns covered = SpriteCuller::getColumns(p, viewportWidth);
+            const int32_t       begin   = int32_t(std::max(xBegin, covered.begin));
+            const int32_t       end     = int32_t(std::min(xEnd, covered.end));
+            for (int32_t x = int32_t(columns.firstFrom(uint32_t(begin))); x < end; x += int32_t(columns.step)) {
+                if (p.depth >= depthBuffer[x]) {
+                    continue; //< hidden behind a wall
+                }
+                float    texU = (float(x) + 0.5f - p.screenLeft) / p.screenWidth;
+                uint32_t u    = std::min(uint32_t(texU * float(mip.width)), uint32_t(mip.width - 1));
+                if constexpr (FEATURES & SCENE_INDEXED) {
+                    drawIndexedColumnSpan<true>(getIndexBufferView(),
+                                                uint32_t(x),
+                                                span.top,
+                                                span.bottom,
+                                                texture.indexColumn(u, level),
+                                                uint32_t(mip.height),
+                                                palette.getColormap(getLightLevel(light)));
+                } else {
+                    drawTexturedColumnSpan<true>(frame,
+                                                 uint32_t(x),
+                                                 span.top,
+                                                 span.bottom,
+                                                 texture.column(u, level),
+                                                 uint32_t(mip.height),
+                                                 light);
+                }
+            }
+        }
+    }
+
+    /// What the bands of a frame share, set up once on the render thread
+    struct ScenePasses {
+        FloorView floorView;
+        int32_t   horizonRow; //< clamped to the frame, see SkyGradient::fill
+        int32_t   skyEnd;     //< first row below the sky
+        SpanRows  coveredSky; //< see getCoveredSkyRows
+        ColumnSet columns;    //< drawn this frame, see Interlacer
+    };
+
+    /// Everything drawBuffer shows, on the render pool: every thread takes horizontal bands of sky, floor and ceiling
+    /// until none are left, waits for the others, then takes vertical strips of walls and sprites. Bands and strips
+    /// never share a pixel, so nothing is locked; the render thread joins once, before the upload. With INDEXED_COLOR the
+    /// passes draw into indexBuffer, and a round of bands expands it into drawBuffer. With INTERLACED, frames that draw
+    /// only half of the columns (see Interlacer) end with a round of bands reconstructing the other half. The threads run
+    /// the pipeline compiled for the frame's features, see getScenePipeline.
+    void drawScenePasses() {
+        {
+            RendererBench bench("scene setup");
+            if (!skyGradient.isValidFor(viewportHeight)) {
+                skyGradient.rebuild(viewportHeight);
+                if constexpr (INDEXED_COLOR) {
+                    skyGradient.quantize(palette);
+                }
+            }
+            depthBuffer.resize(viewportWidth);
+            cullSprites();
+        }
+
+        if constexpr (INTERLACED) {
+            drawBuffer.swap(historyBuffer); //< the last frame, whole
+        }
+
+        const FrameView frame  = getDrawBufferView();
+        ScenePasses     passes = { getFloorView(), 0, 0, {}, ALL_COLUMNS };
+        passes.horizonRow      = std::clamp<int32_t>(passes.floorView.horizon, 0, int32_t(viewportHeight) - 1);
+        passes.skyEnd          = getFloorBegin(frame, passes.floorView);
+        passes.coveredSky      = DEBUG_FLOOR ? SpanRows{} : getCoveredSkyRows(passes.skyEnd);
+
+        Reprojection reprojection = {};
+        if constexpr (INTERLACED) {
+            passes.columns = interlacer.beginFrame(getInterlaceCamera(), columnRays);
+            reprojection   = interlacer.getReprojection({ historyBuffer.data(), viewportWidth, viewportHeight });
+        }
+
+        // chunks of 16 rows / columns: enough of them to balance 16 threads, few enough to keep setup per chunk cheap
+        bands.reset(viewportHeight, 16);
+        strips.reset(viewportWidth, STRIP_COLUMNS);
+        expansions.reset(viewportHeight, 16);
+        reconstructions.reset(viewportHeight, 16);
+
+        const TileMap& tiles    = gameplayState->tiles;
+        const uint32_t features = (tiles.hasCeilings() ? SCENE_CEILINGS : SceneFeature{}) |
+                                  (tiles.hasSeeThrough() ? SCENE_SEE_THROUGH : SceneFeature{}) |
+                                  (passes.columns.step > 1 ? SCENE_INTERLACED : SceneFeature{});
+        const ScenePipeline pipeline = getScenePipeline(features);
+
+        RendererBench bench("scene passes");
+        renderPool->run([this, pipeline, &passes, &reprojection](uint32_t thread, uint32_t) {
+            (this->*pipeline)(passes, reprojection, thread);
+        });
+    }
+
+    /// One render thread's share of drawScenePasses
+    template <uint32_t FEATURES>
+    void runScenePasses(const ScenePasses& passes, const Reprojection& reprojection, uint32_t thread) {
+        Share chunk;
+        while (bands.next(chunk)) {
+            drawBand<FEATURES>(passes, { int32_t(chunk.begin), int32_t(chunk.end) });
+        }
+        renderBarrier->arrive_and_wait(); //< walls and sprites go over the floor
+
+        while (strips.next(chunk)) {
+            drawWalls<FEATURES>(chunk.begin, chunk.end, passes.columns, wallLayerScratch[thread]);
+            drawSprites<FEATURES>(chunk.begin, chunk.end, passes.columns);
+        }
+
+        if constexpr (FEATURES & SCENE_INDEXED) {
+            renderBarrier->arrive_and_wait(); //< every index is final
+            while (expansions.next(chunk)) {
+                expandIndexed(getIndexBufferView(), getDrawBufferView(), palette, { int32_t(chunk.begin), int32_t(chunk.end) });
+            }
+        }
+
+        if constexpr (FEATURES & SCENE_INTERLACED) {
+            renderBarrier->arrive_and_wait(); //< every drawn pixel is final
+            while (reconstructions.next(chunk)) {
+                reconstructColumns(getDrawBufferView(),
+                                   passes.columns,
+                                   reprojection,
+                                   { int32_t(chunk.begin), int32_t(chunk.end) });
+            }
+        }
+    }
+
+    using ScenePipeline = void (GJRenderer::*)(const ScenePasses&, const Reprojection&, uint32_t);
+
+    /// \return runScenePasses compiled for `features` and SCENE_FIXED_FEATURES. One instantiation per combination of
+    /// SCENE_RUNTIME_FEATURES, so the choice costs a table lookup per frame
+    static ScenePipeline getScenePipeline(uint32_t features) {
+        static constexpr FeatureTable<SCENE_FIXED_FEATURES, SCENE_RUNTIME_FEATURES, ScenePipeline> pipelines(
+            []<uint32_t FEATURES>() { return &GJRenderer::runScenePasses<FEATURES>; });
+        return pipelines[features];
+    }
+
+    /// \return `columns` if FEATURES draws only some, else ALL_COLUMNS as a constant the loops over them fold
+    template <uint32_t FEATURES>
+    static ColumnSet getDrawnColumns(ColumnSet columns) {
+        if constexpr (FEATURES & SCENE_INTERLACED) {
+            return columns;
+        } else {
+            return ALL_COLUMNS;
+        }
+    }
+
+    /// Draws the 3D view at `scale` of the low res target from the next frame on. Buffers keep their full size, so this
+    /// allocates nothing; what depends on the resolution (column rays, sky) is rebuilt by its own checks.
+    void setSceneScale(float scale) {
+        viewportWidth  = std::clamp(uint32_t(float(maxViewportWidth) * scale + 0.5f), 1U, maxViewportWidth);
+        viewportHeight = std::clamp(uint32_t(float(maxViewportHeight) * scale + 0.5f), 1U, maxViewportHeight);
+    }
+
+    void drawScene() {
+        const auto sceneStart = std::chrono::steady_clock::now();
+        traceWalls();
+        drawScenePasses();
+
+        // whole 3D view reaches the backend in one upload, stretched over the low res target:
+        backend->drawPixels(drawBuffer.data(),
+                            viewportWidth,
+                            viewportHeight,
+                            { 0.f, 0.f, float(maxViewportWidth), float(maxViewportHeight) });
+
+        // the next frame draws at the resolution this one's time asks for
+        const float sceneMs =
+            std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - sceneStart).count();
+        if (resolutionController.addFrame(sceneMs)) {
+            setSceneScale(resolutionController.getScale());
+        }
     }
 
     void drawUI() {
         if (gameplayState->explodeCd) {
-            D2D1_SIZE_F bitmapSize = GPUBitmaps[toId(EGPUBitmap::Explode)]->GetSize();
-            bitmapSize.height *= 2;
-            bitmapSize.width *= 2;
-            pLowResRenderTarget->DrawBitmap(GPUBitmaps[toId(EGPUBitmap::Explode)].Get(),
-                                            D2D1::RectF(160, 325, 160 + bitmapSize.width, 325 + bitmapSize.height),
-                                            1.0f, // Opacity (1.0f = fully opaque)
-                                            D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
-                                            nullptr // Source rectangle (nullptr to use entire bitmap)
-            );
+            const SizeF size = backend->getImageSize(EGPUBitmap::Explode);
+            backend->drawImage(EGPUBitmap::Explode, { 160, 325, 160 + size.width * 2, 325 + size.height * 2 });
         }
         std::wstring wPoints = std::to_wstring(gameplayState->points);
-
-        textFormats[toId(TextFormat::SMALL)]->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_TRAILING);
-        pRenderTarget->DrawText(wPoints.c_str(), // Text to render
-                                toU32(wcslen(wPoints.c_str())),
-                                textFormats[toId(TextFormat::SMALL)].Get(), // Text format
-                                D2D1::RectF(0, 335, 345, 360),              // Layout rectangle
-                                brushes["white"].Get());
+        backend->drawText(wPoints, TextFormat::SMALL, { 0, 335, 345, 360 }, WHITE, DrawTarget::Window);
 
         if (!gameplayState->qLeapCd) {
-            D2D1_SIZE_F bitmapSize = GPUBitmaps[toId(EGPUBitmap::QLeap)]->GetSize();
-            bitmapSize.height *= 2;
-            bitmapSize.width *= 2;
-            pLowResRenderTarget->DrawBitmap(GPUBitmaps[toId(EGPUBitmap::QLeap)].Get(),
-                                            D2D1::RectF(15, 325, 15 + bitmapSize.width, 325 + bitmapSize.height),
-                                            1.0f, // Opacity (1.0f = fully opaque)
-                                            D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
-                                            nullptr // Source rectangle (nullptr to use entire bitmap)
-            );
+            const SizeF size = backend->getImageSize(EGPUBitmap::QLeap);
+            backend->drawImage(EGPUBitmap::QLeap, { 15, 325, 15 + size.width * 2, 325 + size.height * 2 });
         }
         drawMinimap();
     }
 
     void drawBorder() {
-        D2D1_RECT_F unitSquare = D2D1::RectF(0.f, 0.f, float(viewportWidth), float(viewportHeight));
-        pRenderTarget->DrawRectangle(unitSquare, brushes["amber"].Get(), 2.f);
+        // 2 pixel wide outline, centered on the edges of the unit square
+        const float  w     = float(maxViewportWidth);
+        const float  h     = float(maxViewportHeight);
+        const ColorF amber = { 1.f, 1.f, 0.7f };
+        backend->fillRectangle({ -1, -1, w + 1, 1 }, amber, DrawTarget::Window);
+        backend->fillRectangle({ -1, h - 1, w + 1, h + 1 }, amber, DrawTarget::Window);
+        backend->fillRectangle({ -1, 1, 1, h - 1 }, amber, DrawTarget::Window);
+        backend->fillRectangle({ w - 1, 1, w + 1, h - 1 }, amber, DrawTarget::Window);
     }
 
     void drawPaused() {
-        pLowResRenderTarget->DrawText(L"Paused", // Text to render
-                                      toU32(wcslen(L"Paused")),
-                                      textFormats[static_cast<size_t>(TextFormat::HEADING)].Get(), // Text format
-                                      D2D1::RectF(0, 40, 360, 180),                                // Layout rectangle
-                                      brushes["white"].Get());
-
-        std::wstring t = L"[ESC] Resume\n[R] Reload\n[BSPACE] Quit";
-        pLowResRenderTarget->DrawText(t.c_str(), // Text to render
-                                      toU32(wcslen(t.c_str())),
-                                      textFormats[static_cast<size_t>(TextFormat::NORMAL)].Get(), // Text format
-                                      D2D1::RectF(0, 180, 320, 210),                              // Layout rectangle
-                                      brushes["white"].Get());
+        backend->drawText(L"Paused", TextFormat::HEADING, { 0, 40, 360, 180 }, WHITE, DrawTarget::LowRes);
+        backend->drawText(L"[ESC] Resume\n[R] Reload\n[BSPACE] Quit",
+                          TextFormat::NORMAL,
+                          { 0, 180, 320, 210 },
+                          WHITE,
+                          DrawTarget::LowRes);
     }
 
     void drawEnd(const std::wstring& text) {
-        std::wstring heading = std::format(L"{}\nHiScore: {}", text, gameplayState->hiScore);
-        pLowResRenderTarget->DrawText(heading.c_str(), // Text to render
-                                      toU32(wcslen(heading.c_str())),
-                                      textFormats[static_cast<size_t>(TextFormat::HEADING)].Get(), // Text format
-                                      D2D1::RectF(0, 40, 360, 180),                                // Layout rectangle
-                                      brushes["white"].Get());
-
-        pLowResRenderTarget->DrawText(L"[R] Reload\n[BSPACE] Quit", // Text to render
-                                      toU32(wcslen(L"[R] Reload\n[BSPACE] Quit")),
-                                      textFormats[static_cast<size_t>(TextFormat::NORMAL)].Get(), // Text format
-                                      D2D1::RectF(0, 220, 320, 300),                              // Layout rectangle
-                                      brushes["white"].Get());
+        std::wstring heading = text + L"\nHiScore: " + std::to_wstring(gameplayState->hiScore);
+        backend->drawText(heading, TextFormat::HEADING, { 0, 40, 360, 180 }, WHITE, DrawTarget::LowRes);
+        backend->drawText(L"[R] Reload\n[BSPACE] Quit", TextFormat::NORMAL, { 0, 220, 320, 300 }, WHITE, DrawTarget::LowRes);
     }
 
     void drawMenu(const std::string& UNUSED(text)) {
         // todo
-        pLowResRenderTarget->DrawText(L"Electric\nBubble\nBath!", // Text to render
-                                      toU32(wcslen(L"Electric\nBubble\nBath!")),
-                                      textFormats[static_cast<size_t>(TextFormat::HEADING)].Get(), // Text format
-                                      D2D1::RectF(0, 40, 360, 180),                                // Layout rectangle
-                                      brushes["blue"].Get());
-
-        pLowResRenderTarget->DrawText(L"[ENTER] Game\n[BSPACE] Quit", // Text to render
-                                      toU32(wcslen(L"[ENTER] Game\nF[BSPACE] Quit")),
-                                      textFormats[static_cast<size_t>(TextFormat::NORMAL)].Get(), // Text format
-                                      D2D1::RectF(0, 180, 320, 210),                              // Layout rectangle
-                                      brushes["blue"].Get());
+        backend->drawText(L"Electric\nBubble\nBath!", TextFormat::HEADING, { 0, 40, 360, 180 }, BLUE, DrawTarget::LowRes);
+        backend->drawText(L"[ENTER] Game\n[BSPACE] Quit", TextFormat::NORMAL, { 0, 180, 320, 210 }, BLUE, DrawTarget::LowRes);
 
         // pRenderTarget->DrawText(
         //	L"[F10] Terminate Program",    // Text to render
@@ -618,242 +791,303 @@ public:
         // pRenderTarget->DrawRectangle(unitSquare, brushes["blue"], 3.f);
     }
 
-    /* output: perspective correction coefficient */
-    float getPixelDir(int x, OUT XMVECTOR& dir) {
-        float imagePlaneDistance = scene->camera.getImagePlaneDistance(); // depends on field of view
-        float pixelDirection     = (float(x) - HscrW()) / viewportWidth;  // -0.5 to 0.5 (because image plane has width 1)
-        dir                      = { imagePlaneDistance, pixelDirection, 0.f, 0.f };
-        dir                      = XMVector3Normalize(dir);
-        float screenSpaceAngle   = std::atan2f(XMVectorGetY(dir), XMVectorGetX(dir));
-
-        // todo use scene->camera.getDirectionAngle() ?
-        float angle =
-            std::atan2f(XMVectorGetY(scene->camera.getDirectionVector()), XMVectorGetX(scene->camera.getDirectionVector()));
-        XMVECTOR worldFromScreen = XMQuaternionRotationAxis(FXMVECTOR{ 0, 0, 1, 0 }, angle);
-        dir                      = XMVector3Rotate(dir, worldFromScreen);
-        assert(DirectX::Internal::XMVector3IsUnit(dir));
-
-        return std::abs(cos(screenSpaceAngle));
+    /// What the next passes draw, as draw sets it. For driving single passes, e.g. from a benchmark
+    void setFrame(const GameplayState& frameState, const GJScene& frameScene) {
+        gameplayState = &frameState;
+        scene         = &frameScene;
     }
 
+    /// Any thread. The backend follows the window's new size before the next frame
+    void requestResize() { resizeRequested = true; }
 
-    void wmResize(HWND hwnd) {
-        if (pRenderTarget) {
-            RECT rc;
-            GetClientRect(hwnd, &rc);
-            pRenderTarget->Resize(D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top));
+    /// Loads assets/textures/<textureId>.png into textures[textureId] (if not loaded yet), with mips, in `layout`
+    void loadTexture(std::vector<CPUBitmap>& textures, size_t textureId, TexelLayout layout) {
+        if (textures.size() <= textureId) {
+            textures.resize(textureId + 1);
+        }
+        if (textures[textureId].data.empty()) {
+            textures[textureId] = backend->decodeImage(L"assets/textures/" + std::to_wstring(textureId) + L".png");
+            textures[textureId].setLayout(layout);
+            textures[textureId].generateMips();
         }
     }
 
-    void loadGPUBitmap(const std::wstring& filePath, EGPUBitmap eBitmap) {
-        ComPtr<IWICBitmapDecoder> pDecoder;
-        HRESULT                   hr = pWICFactory->CreateDecoderFromFilename(filePath.c_str(),
-                                                            nullptr,
-                                                            GENERIC_READ,
-                                                            WICDecodeMetadataCacheOnLoad,
-                                                            &pDecoder);
-        checkFailed(hr, hWnd, "CreateDecoderFromFileName failed");
+    /// Loads the wall texture of every tile type that has walls
+    void loadWallTextures() {
+        for (const TileTypeDesc& desc : TILE_TYPES) {
+            if (desc.attributes.height > 0) {
+                loadTexture(wallTextures, desc.attributes.textureId, TexelLayout::ColumnMajor);
+            }
+        }
+    }
 
-        // Get the first frame of the image
-        ComPtr<IWICBitmapFrameDecode> pFrame;
-        hr = pDecoder->GetFrame(0, &pFrame);
-        checkFailed(hr, hWnd, "GetFrame failed");
+    /// Loads the ceiling texture of every tile type that has a ceiling
+    void loadCeilingTextures() {
+        for (const TileTypeDesc& desc : TILE_TYPES) {
+            const uint8_t id = desc.attributes.ceilingTextureId;
+            if (id == NO_CEILING) {
+                continue;
+            }
+            loadTexture(ceilingTextures, id, TexelLayout::RowMajor);
+            if (!std::has_single_bit(ceilingTextures[id].width) || !std::has_single_bit(ceilingTextures[id].height)) {
+                throw std::runtime_error(fmt::format("ceiling texture {} sides must be powers of two, see FloorTexture", id));
+            }
+        }
+    }
 
-        // Convert the image format to BGRA, which Direct2D expects
-        ComPtr<IWICFormatConverter> pConverter;
-        hr = pWICFactory->CreateFormatConverter(&pConverter);
-        checkFailed(hr, hWnd, "CreateFormatConverter failed");
+    void loadSpriteTextures() {
+        loadTexture(spriteTextures, ENTITY_SPRITE_TEXTURE, TexelLayout::ColumnMajor);
+        loadTexture(spriteTextures, OBSTACLE_SPRITE_TEXTURE, TexelLayout::ColumnMajor);
+    }
 
-        hr = pConverter->Initialize(pFrame.Get(),
-                                    GUID_WICPixelFormat32bppPBGRA, // Direct2D expects BGRA format with premultiplied alpha
-                                    WICBitmapDitherTypeNone,
-                                    nullptr,
-                                    0.0,
-                                    WICBitmapPaletteTypeMedianCut);
-        checkFailed(hr, hWnd, "initialize failed");
+    void initDrawBuffer(const std::wstring& filePath) {
+        // CPU Side:
+        floorCPUTex = backend->decodeImage(filePath);
+        if (!std::has_single_bit(floorCPUTex.width) || !std::has_single_bit(floorCPUTex.height)) {
+            throw std::runtime_error("floor texture sides must be powers of two, see FloorTexture");
+        }
+        floorCPUTex.generateMips();
 
-        hr = pRenderTarget->CreateBitmapFromWicBitmap(pConverter.Get(),
-                                                      nullptr, // Bitmap properties; nullptr for default
-                                                      &GPUBitmaps[toId(eBitmap)]);
-        checkFailed(hr, hWnd, "createBitmapFromWicBitmap failed");
+        drawBuffer = std::vector<uint32_t>(viewportWidth * viewportHeight, 0x000000FF);
+        if constexpr (INTERLACED) {
+            historyBuffer = drawBuffer;
+            interlacer.reset();
+        }
     }
 
+    /// Picks the palette from all loaded textures, the sky and the fog, then quantizes the textures to it.
+    /// INDEXED_COLOR only, after the textures are loaded
+    void initPalette() {
+        skyGradient.rebuild(viewportHeight);
 
-    void initDrawBuffer(const std::wstring& filePath) {
-        // CPU Side:
-        ComPtr<IWICBitmapDecoder> decoder;
-        HRESULT                   hr = pWICFactory->CreateDecoderFromFilename(filePath.c_str(),
-                                                            nullptr,
-                                                            GENERIC_READ,
-                                                            WICDecodeMetadataCacheOnDemand,
-                                                            &decoder);
-        checkFailed(hr, hWnd, "Failed to load image");
-
-        // Get the first frame of the image
-        ComPtr<IWICBitmapFrameDecode> frame;
-        hr = decoder->GetFrame(0, &frame);
-        checkFailed(hr, hWnd, "failed to get image frame");
-
-        UINT width, height;
-        frame->GetSize(&width, &height);
-
-        ComPtr<IWICFormatConverter> pConverter;
-        hr = pWICFactory->CreateFormatConverter(&pConverter);
-        checkFailed(hr, hWnd, "failed to create format converter\n");
-
-        hr = pConverter->Initialize(frame.Get(),
-                                    GUID_WICPixelFormat32bppBGRA,
-                                    WICBitmapDitherTypeNone,
-                                    nullptr,
-                                    0,
-                                    WICBitmapPaletteTypeCustom);
-        checkFailed(hr, hWnd, "failed to init format converter");
-
-        // Allocate memory for pixel data
-        floorCPUTex = CPUBitmap(width, height, 4, {});
-        floorCPUTex.data.resize(width * height * 4);
-
-        // Copy pixels to the vector
-        hr = pConverter->CopyPixels(nullptr, width * 4, static_cast<UINT>(floorCPUTex.data.size()), floorCPUTex.data.data());
-        checkFailed(hr, hWnd, "failed to copy pixels");
-
-        // GPU Side:
-        D2D1_SIZE_U            size  = { viewportWidth, viewportHeight };
-        D2D1_BITMAP_PROPERTIES props = {
-            { DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED }, // BGRA format required for Direct2D
-            96.0f,
-            96.0f // DPI
+        std::vector<const CPUBitmap*> textures = { &floorCPUTex };
+        for (const std::vector<CPUBitmap>* loaded : { &wallTextures, &ceilingTextures, &spriteTextures }) {
+            for (const CPUBitmap& texture : *loaded) {
+                if (!texture.data.empty()) {
+                    textures.push_back(&texture);
+                }
+            }
+        }
+        std::vector<uint32_t> extraColors = skyGradient.getColors();
+        for (float distance = 0.f; distance <= MAXVIEWDIST; distance += MAXVIEWDIST / 8.f) {
+            for (RayHit::Side side : { RayHit::NULLSIDE, RayHit::EAST_WEST, RayHit::NORTH_SOUTH }) {
+                extraColors.push_back(getFogWallColor(distance, side));
+            }
+        }
+        palette.build(textures, extraColors);
+        skyGradient.quantize(palette);
+
+        auto quantizeAll = [this](const std::vector<CPUBitmap>& from, std::vector<CPUBitmap>& to) {
+            to.clear();
+            for (const CPUBitmap& texture : from) {
+                to.push_back(texture.data.empty() ? CPUBitmap{} : palette.quantize(texture));
+            }
         };
+        quantizeAll(wallTextures, indexedTextures.walls);
+        quantizeAll(ceilingTextures, indexedTextures.ceilings);
+        quantizeAll(spriteTextures, indexedTextures.sprites);
+        indexedTextures.floor = palette.quantize(floorCPUTex);
+        indexBuffer.assign(size_t(viewportWidth) * viewportHeight, TRANSPARENT_INDEX);
+    }
 
-        drawBuffer = std::vector<uint32_t>(viewportWidth * viewportHeight, 0x000000FF);
-        pLowResRenderTarget->CreateBitmap(size, nullptr, 0, &props, &pFloorGPUBitmap);
-    }
-
-    void updateDrawBuffer() {
-        // Sky
-
-        // float t_horizon = scene->zDir / scene->minZ;
-        // horizon = std::clamp(horizon, 0, viewportHeight - 1); //< todo delete?
-        float topBandHeight = 0.3f * viewportHeight;
-        int   r_top         = 200;
-        int   g_top         = 150;
-        int   b_top         = 150;
-        int   r_min         = 50;
-        int   g_min         = 25;
-        int   b_min         = 25;
-        // Compute the geometric factor f so that (h0 - f) / (1 - f) == horizon.
-        // Derived from:
-        //   Sum S = (topBandHeight - f)/(1 - f)  must equal horizon.
-
-        float f = (float(viewportHeight) - topBandHeight) / (float(viewportHeight) - 1.f);
-
-        // Compute the (non-integer) number of bands so that last band = 1 pixel:
-        float Nf = 1 + log(1.0f / topBandHeight) / log(f);
-        assert(Nf > 0.f);
-        uint32_t N = toU32(std::ceil(Nf));
-
-        int   yPos = std::clamp<int>(getHorizon(scene->camera.pitch), 0U, viewportHeight - 1U);
-        int   bandHeight;
-        float bandHeightF;
-        for (uint32_t i = N; i >= 0 && yPos >= 0; --i) {
-            // Compute this band's height (using the geometric progression)
-            bandHeightF = topBandHeight * std::pow(f, i);
-            bandHeight  = std::max(1, int(std::round(bandHeightF)));
-
-            // Compute color interpolation factor (0 at top, 1 at bottom)
-            float    t_r   = (N > 1) ? float(i) / (N - 1) : 0.f;
-            float    t_g   = (N > 1) ? float(i) / (N - 1) : 0.f;
-            uint8_t  r     = uint8_t(std::round(r_top + t_r * (r_min - r_top)));
-            uint8_t  g     = uint8_t(std::round(g_top + t_g * (g_min - g_top)));
-            uint8_t  b     = uint8_t(std::round(b_top + t_g * (b_min - b_top)));
-            uint32_t color = (0xFF << 24) | (r << 16) | (g << 8) | b;
-
-            // Draw the horizontal band.
-            for (int y = yPos; y >= 0; --y) {
-                for (int x = 0; x < viewportWidth; ++x) {
-                    drawBuffer[size_t(y * viewportWidth + x)] = color;
+    /// \return sky rows that opaque walls cover in every column. Usually the rows around the horizon, where the walls are
+    /// \param skyEnd first row below the sky
+    SpanRows getCoveredSkyRows(int32_t skyEnd) {
+        const ColumnHits& columnHits = columnHitCache.getHits();
+        const FrameView   frame      = getDrawBufferView();
+        SpanRows          covered    = { 0, skyEnd };
+        for (uint32_t x = 0; x < viewportWidth && covered.begin < covered.end; ++x) {
+            const float distance = std::clamp(columnHits.distance[x], 0.f, MAXVIEWDIST) * columnRays.fixPersp[x];
+            float       height   = 1.f; //< the fog wall
+            if (columnHits.side[x] != RayHit::NULLSIDE) {
+                const TileAttributes& tile =
+                    gameplayState->getTile(size_t(columnHits.cellX[x]), size_t(columnHits.cellY[x]));
+                if (tile.transparency > 0) {
+                    return {};
                 }
+                height = tile.height / 255.f;
             }
-            yPos -= bandHeight;
+            const WallSpan span = getWallSpan(distance, height);
+            const SpanRows rows = clipSpan(frame, span.top, span.bottom);
+            covered             = { std::max(covered.begin, rows.begin), std::min(covered.end, rows.end) };
+        }
+        return covered;
+    }
+
+    /// Sky, floor and ceiling of rows `band`
+    template <uint32_t FEATURES>
+    void drawBand(const ScenePasses& passes, SpanRows band) {
+        if constexpr (FEATURES & SCENE_INDEXED) {
+            drawBand<FEATURES>(getIndexBufferView(), indexedTextures.floor, passes, band);
+        } else {
+            drawBand<FEATURES>(getDrawBufferView(), floorCPUTex, passes, band);
         }
+    }
 
+    /// \param floorTexture palette indexed for an IndexedFrameView
+    template <uint32_t FEATURES, typename Pixel>
+    void drawBand(const BasicFrameView<Pixel>& frame,
+                  const CPUBitmap&             floorTexture,
+                  const ScenePasses&           passes,
+                  SpanRows                     band) {
+        // * Sky: cached gradient, offset by the horizon
+        const SpanRows  sky     = { band.begin, std::min(band.end, passes.skyEnd) };
+        const SpanRows& covered = passes.coveredSky;
+        if (covered.begin < covered.end) {
+            skyGradient.fill(frame, passes.horizonRow, sky.begin, std::min(sky.end, covered.begin));
+            skyGradient.fill(frame, passes.horizonRow, std::max(sky.begin, covered.end), sky.end);
+        } else {
+            skyGradient.fill(frame, passes.horizonRow, sky.begin, sky.end);
+        }
 
         // v Floor:
-        float horTan     = std::tan(scene->camera.getFov() / 2.f); //< horizontal tan
-        float screenDist = HscrH<float>() / scene->camera.getVfov();
-        float _x         = 0.f;
-        float _y         = 0.f;
-        // float perspective = 0; // 0 to 1
-
-        int y = std::clamp<int>(getHorizon(scene->camera.pitch) + 1, 0, viewportHeight - 1);
-        for (; y < viewportHeight; ++y) {
-            float zAngle =
-                std::atan2f(screenDist, toF(y - getHorizon(scene->camera.pitch) - 1)); // hor.angle of vision for pix y.
-            float y_d = scene->camera.camHeight * std::tanf(zAngle); // distance along y-plane that scanline meets floor-plane
-
-            // v   opposite = tan(a) * adj
-            float horWidth =
-                horTan *
-                y_d; //< half horizontal width (how many units we can see horizontally to the left of center in this scanline)
-            for (int x = 0; x < viewportWidth; ++x) {
-                float x_t = (x - HscrW<float>()) / HscrW<float>(); // -1 (left) to 1 (right)
-                // float screenAngle = (scene->getFov() / 2.f) * x_t; // results in slight perspective warp
-                float screenAngle = std::atan2f(horWidth * x_t, y_d); //< hor.angle of vision for pix x.
-                float angle       = scene->camera.getDirectionAngle() + screenAngle;
-
-                // v   hyp		   = adj / cos(a)
-                float perspCorrect = y_d / std::cosf(screenAngle);
-
-                _x = std::cosf(angle) * perspCorrect;
-                _y = std::sinf(angle) * perspCorrect;
-
-                // translate
-                _y += XMVectorGetY(scene->camera.position);
-                _x += XMVectorGetX(scene->camera.position);
-
-                // spdlog::info("x: {}, y: {}, _x: {}, _y: {}\n",x, y, _x, _y);
-                uint32_t sample                   = sampleFloor(_x, _y);
-                drawBuffer[y * viewportWidth + x] = sample;
-            }
+        const ColumnSet columns = getDrawnColumns<FEATURES>(passes.columns);
+        if constexpr (FEATURES & SCENE_DEBUG_FLOOR) {
+            castFloor(
+                frame,
+                passes.floorView,
+                [this](float x, float y) { return toPixel<Pixel>(sampleFloor(x, y)); },
+                band,
+                columns);
+        } else if constexpr (FEATURES & SCENE_CEILINGS) {
+            castFloorAndCeiling(
+                frame,
+                passes.floorView,
+                floorTexture,
+                1.f,
+                [this](int64_t x, int64_t y) { return getCeilingTexture(x, y); },
+                getSimdLevel(),
+                band,
+                columns);
+        } else {
+            castFloorTextured(frame, passes.floorView, floorTexture, getSimdLevel(), band, columns);
         }
     }
 
-    HWND hWnd;
+    /// \return `color`, or its palette index for an IndexedFrameView
+    template <typename Pixel>
+    Pixel toPixel(uint32_t color) const {
+        if constexpr (sizeof(Pixel) == 1) {
+            return palette.nearest(color);
+        } else {
+            return color;
+        }
+    }
 
-private:
-    void checkFailed(HRESULT hr, HWND hwnd, const std::string& message) {
-        assert(!FAILED(hr)); // break into debugger
-        if (FAILED(hr)) {
-            MessageBoxA(NULL, message.c_str(), "Error", MB_OK);
-            DestroyWindow(hwnd);
-            CoUninitialize();
-            exit(-1);
+    /// Palette indexed with INDEXED_COLOR, see TileAttributes::textureId
+    const CPUBitmap& getWallTexture(uint8_t textureId) const {
+        return INDEXED_COLOR ? indexedTextures.walls[textureId] : wallTextures[textureId];
+    }
+
+    /// \return nullptr outside the map and for tiles without a ceiling. Palette indexed with INDEXED_COLOR
+    const CPUBitmap* getCeilingTexture(int64_t x, int64_t y) const {
+        const TileMap& tiles = gameplayState->tiles;
+        if (x < 0 || y < 0 || uint64_t(x) >= tiles.getWidth() || uint64_t(y) >= tiles.getHeight()) {
+            return nullptr;
+        }
+        const uint8_t id = tiles.getAttributes(size_t(x), size_t(y)).ceilingTextureId;
+        if (id == NO_CEILING) {
+            return nullptr;
+        }
+        return INDEXED_COLOR ? &indexedTextures.ceilings[id] : &ceilingTextures[id];
+    }
+
+    /// This frame's camera, as the Interlacer compares it to the last one. After updateColumnRays
+    InterlaceCamera getInterlaceCamera() const {
+        return { XMVectorGetX(scene->camera.position),
+                 XMVectorGetY(scene->camera.position),
+                 scene->camera.camHeight,
+                 scene->camera.getDirectionAngle(),
+                 getHorizon(scene->camera.pitch),
+                 columnRays.imagePlaneDistance,
+                 viewportWidth,
+                 viewportHeight };
+    }
+
+    FloorView getFloorView() const {
+        return { XMVectorGetX(scene->camera.position),
+                 XMVectorGetY(scene->camera.position),
+                 scene->camera.getDirectionAngle(),
+                 scene->camera.camHeight,
+                 float(viewportHeight) / 2.f / scene->camera.getVfov(),
+                 std::tan(scene->camera.getFov() / 2.f),
+                 getHorizon(scene->camera.pitch) };
+    }
+
+    /// RENDER_THREADS, or one thread per hardware thread but two, left to the simulation thread and audio
+    static uint32_t getConfiguredRenderThreads() {
+        if constexpr (RENDER_THREADS > 0) {
+            return RENDER_THREADS;
         }
+        return std::max(std::thread::hardware_concurrency(), 3U) - 2;
+    }
+
+    /// Replaces the render pool. \param threadCount including the render thread, so 1 draws everything on it
+    void setRenderThreadCount(uint32_t threadCount) {
+        renderPool    = std::make_unique<WorkerPool>(threadCount);
+        renderBarrier = std::make_unique<std::barrier<>>(renderPool->getThreadCount());
+        wallLayerScratch.resize(renderPool->getThreadCount());
     }
 
+    RenderBackend& getBackend() { return *backend; }
+
+private:
+    FrameView getDrawBufferView() { return { drawBuffer.data(), viewportWidth, viewportHeight }; }
+    IndexedFrameView getIndexBufferView() { return { indexBuffer.data(), viewportWidth, viewportHeight }; }
+
+    static constexpr uint32_t STRIP_COLUMNS = 16; //< per chunk of strips, and per bin of sprites, see drawSprites
+
+    static constexpr ColorF WHITE = { 1.f, 1.f, 1.f };
+    static constexpr ColorF BLUE  = { 0.49f, 0.995f, 0.995f };
+
 private:
-    std::wstring                                        fontName = L"Press Start 2P";
-    uint32_t                                            viewportWidth;  //< adjusted for upscaling
-    uint32_t                                            viewportHeight; //< adjusted for upscaling
-    const GJScene*                                      scene               = nullptr;
-    ComPtr<ID2D1HwndRenderTarget>                       pRenderTarget       = nullptr;
-    ComPtr<ID2D1BitmapRenderTarget>                     pLowResRenderTarget = nullptr;
-    ComPtr<ID2D1Factory>                                pFactory            = nullptr;
-    ComPtr<IWICImagingFactory>                          pWICFactory         = nullptr;
-    std::map<std::string, ComPtr<ID2D1SolidColorBrush>> brushes             = { { "black", nullptr },
-                                                                                { "green", nullptr },
-                                                                                { "amber", nullptr },
-                                                                                { "blue", nullptr } };
-    ComPtr<ID2D1SolidColorBrush>                        brush = nullptr; //< multi-purpose brush to be used with .SetColor();
-    std::array<ComPtr<IDWriteTextFormat>, static_cast<size_t>(TextFormat::size)> textFormats;
+    std::unique_ptr<RenderBackend>                      backend;
+    uint32_t                                            viewportWidth;     //< of the 3D view, see setSceneScale
+    uint32_t                                            viewportHeight;    //< of the 3D view, see setSceneScale
+    uint32_t                                            maxViewportWidth;  //< of the low res target, adjusted for upscaling
+    uint32_t                                            maxViewportHeight; //< of the low res target, adjusted for upscaling
+    ResolutionController                                resolutionController = { { RESOLUTION_SCALES.begin(), RESOLUTION_SCALES.end() },
+                                                                             SCENE_BUDGET_MS };
+    const GJScene*                                      scene = nullptr; //< of the frame being drawn
     using DrawFunction = void (GJRenderer::*)();
     std::array<DrawFunction, static_cast<size_t>(State::size)> drawCallTable;
 
-    std::array<ComPtr<ID2D1Bitmap>, toId(EGPUBitmap::size)> GPUBitmaps;
     std::array<CPUBitmap, toId(ECPUBitmap::size)>           CPUBitmaps;
-    ComPtr<ID2D1Bitmap>                                     pFloorGPUBitmap; // in initDrawBuffer
     std::vector<uint32_t>                                   drawBuffer;      // in initDrawBuffer
+    std::vector<uint32_t>                                   historyBuffer;   // in initDrawBuffer, the last frame. INTERLACED only
     CPUBitmap                                               floorCPUTex;
+    std::vector<CPUBitmap>                                  wallTextures;    //< by TileAttributes::textureId, column-major
+    std::vector<CPUBitmap>                                  ceilingTextures; //< by TileAttributes::ceilingTextureId
+    std::vector<CPUBitmap>                                  spriteTextures;  //< by Sprite::textureId, column-major
+
+    /// Palette indexed copies of the textures above, INDEXED_COLOR only
+    struct IndexedTextures {
+        std::vector<CPUBitmap> walls;
+        std::vector<CPUBitmap> ceilings;
+        std::vector<CPUBitmap> sprites;
+        CPUBitmap              floor;
+    };
+    IndexedTextures                                         indexedTextures; // in initPalette
+    Palette                                                 palette;         // in initPalette
+    std::vector<uint8_t>                                    indexBuffer;     // in initPalette, expanded into drawBuffer
+    std::vector<float>                                      depthBuffer;     //< per column, perpendicular wall distance
+    std::vector<Sprite>                                     sprites;         //< per frame, reused
+    SpriteCuller                                            spriteCuller;
     float                                                   MAXVIEWDIST = 40.f;
-    const GameplayState*                                    gameplayState;
+    SkyGradient                                             skyGradient; //< rebuilt on viewport height change
+    ColumnRayTable                                          columnRays;  //< rebuilt on FOV / viewport width change
+    std::vector<float>                                      columnDirX;  //< per frame, world space
+    std::vector<float>                                      columnDirY;  //< per frame, world space
+    ColumnHitCache                                          columnHitCache; //< output of the wall trace, kept between frames
+    std::unique_ptr<WorkerPool>                             renderPool;       //< see drawScenePasses
+    std::unique_ptr<std::barrier<>>                         renderBarrier;    //< between the bands and the strips
+    ChunkQueue                                              bands;            //< rows, per frame
+    ChunkQueue                                              strips;           //< columns, per frame
+    ChunkQueue                                              expansions;       //< rows, per frame. INDEXED_COLOR only
+    ChunkQueue                                              reconstructions;  //< rows, per frame. INTERLACED only
+    Interlacer                                              interlacer;       //< INTERLACED only
+    std::vector<WallLayerScratch>                           wallLayerScratch; //< per render thread
+    const GameplayState*                                    gameplayState = nullptr; //< of the frame being drawn
+    std::atomic<bool>                                       resizeRequested = false;
+    MinimapImage                                            minimap; //< tile layer of the minimap, see syncMinimap
 };
@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+// Dynamic resolution of the 3D view. Free of DirectX / Windows dependencies.
+
+/// Holds the time the 3D view takes to a budget by stepping its resolution through a few fixed scales. Decisions use
+/// the mean of the last WINDOW frames, all drawn at the current step: it steps down when the mean is over budget, and
+/// up when the mean scaled to the next step's pixel count would still leave some headroom. Few steps and a fresh window
+/// after every change keep it from oscillating or churning what depends on the resolution.
+class ResolutionController {
+public:
+    static constexpr size_t WINDOW   = 30;   //< frames, half a second at 60 fps
+    static constexpr float  HEADROOM = 0.9f; //< of the budget the next step up is predicted to take, at most
+
+    /// \param _scales of the full resolution, largest first. Starts at the first
+    /// \param _budgetMs time to hold per frame
+    ResolutionController(std::vector<float> _scales, float _budgetMs)
+        : scales(std::move(_scales))
+        , budgetMs(_budgetMs) {
+        assert(!scales.empty() && std::is_sorted(scales.rbegin(), scales.rend()));
+    }
+
+    /// \return fraction of the full width and height to draw at
+    float getScale() const { return scales[step]; }
+
+    /// Records the time of a frame drawn at getScale(). \return true if getScale() changed
+    bool addFrame(float ms) {
+        samples[count++ % WINDOW] = ms;
+        if (count < WINDOW) {
+            return false;
+        }
+        const float mean = std::accumulate(samples.begin(), samples.end(), 0.f) / float(WINDOW);
+        if (mean > budgetMs && step + 1 < scales.size()) {
+            return setStep(step + 1);
+        }
+        if (step > 0) {
+            // cost grows with the pixel count
+            const float ratio     = scales[step - 1] / scales[step];
+            const float predicted = mean * ratio * ratio;
+            if (predicted < budgetMs * HEADROOM) {
+                return setStep(step - 1);
+            }
+        }
+        return false;
+    }
+
+private:
+    bool setStep(size_t newStep) {
+        step  = newStep;
+        count = 0;
+        return true;
+    }
+
+    std::vector<float>        scales;
+    float                     budgetMs;
+    size_t                    step    = 0;
+    size_t                    count   = 0; //< frames recorded at this step
+    std::array<float, WINDOW> samples = {};
+};
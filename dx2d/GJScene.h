@@ -6,30 +6,47 @@
 #include <random>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
+#include <array>
+#include <tuple>
 #include <numbers>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <system_error>
 
-#include <DirectXMath.h>
+#include "danny/cppUtil.h"
+#include "danny/cpp3rdParty.h"
+#define FMT_UNICODE 0 // https://github.com/gabime/spdlog/issues/3251
+#include "spdlog/spdlog.h"
 
 #include "Animation.h"
+#include "GJTileMap.h"
+#include "GJVectorMath.h"
 
 using namespace DirectX;
 
 BOOST_DEFINE_ENUM_CLASS(State, MAINMENU, PREGAME, INGAME, PAUSED, LOSS, WIN, size);
 
+/// The part of GameplayState that changes during a game, handed to the render thread with every tick
+struct GameplayStatus {
+    State    state       = State::MAINMENU;
+    bool     explodeCd   = false;
+    bool     qLeapCd     = false;
+    bool     qLeapActive = false;
+    uint64_t hiScore     = 0;
+    uint64_t points      = 100;
+};
+
 /* Simulation writes to GameplayState, Renderer displays only */
-struct GameplayState {
-    std::string map         = "no_map";
-    uint64_t    width       = 0;
-    uint64_t    height      = 0;
-    std::string fileName    = "no_mapFile";
-    State       state       = State::MAINMENU;
-    bool        explodeCd   = false;
-    bool        qLeapCd     = false;
-    bool        qLeapActive = false;
-    uint64_t    hiScore     = 0;
-    uint64_t    points      = 100;
-
-    const char& getTile(size_t x, size_t y) const { return map[y * width + x]; }
+struct GameplayState : GameplayStatus {
+    TileMap     tiles; //< fixed once the map is loaded
+    uint64_t    width    = 0;
+    uint64_t    height   = 0;
+    std::string fileName = "no_mapFile";
+
+    const TileAttributes& getTile(size_t x, size_t y) const { return tiles.getAttributes(x, y); }
+    bool                  isSolid(size_t x, size_t y) const { return tiles.isSolid(x, y); }
 };
 
 enum class EntityType {
@@ -47,11 +64,6 @@ struct Entity {
     void moveBy(const XMVECTOR& by) { position += by; }
     void setX(float x) { XMVectorSetX(position, x); }
     void setY(float y) { XMVectorSetY(position, y); }
-    void interpolate(const Entity& e1, const Entity& e2, float alpha) {
-        size     = e1.size * (1.f - alpha) + e2.size * alpha;
-        momentum = XMVector4Normalize(XMVectorLerp(e1.momentum, e2.momentum, alpha));
-        position = XMVector4Normalize(XMVectorLerp(e1.position, e2.position, alpha));
-    }
 
     bool collides(const Entity& other, float cheatParam = 0.f) {
         XMVECTOR delta         = XMVectorAbs(position - other.position);
@@ -79,7 +91,7 @@ struct GJScene {
 
     void resetEntities() {
         entities.fill(Entity{});
-        for (int i = 0; i < entities.size(); ++i) {
+        for (size_t i = 0; i < entities.size(); ++i) {
             entities[i].health   = 1;
             entities[i].size     = 2;
             entities[i].position = { 180.f, 240.f, 0.f, 0.f };
@@ -122,20 +134,10 @@ struct GJScene {
     // }
 
 
-    void interpolate(const GJScene& other, float alpha) {
-        for (int i = 0; i < entities.size(); ++i) {
-            entities[i].interpolate(entities[i], other.entities[i], alpha);
-        }
-        for (int i = 0; i < obstacles.size(); ++i) {
-            obstacles[i].interpolate(obstacles[i], other.obstacles[i], alpha);
-        }
-        camera.interpolate(camera, other.camera, alpha);
-    }
-
 public:
     // v * Non-interpolatable:
 
-    // v * Interpolatable (4):
+    // v * Interpolatable (4), see ScenePose:
     std::array<Entity, 4>  entities{}; //< controlable
     std::array<Entity, 25> obstacles{};
 
@@ -152,8 +154,7 @@ public:
         float pitch     = 0; //< radians. We keep pitch out of `directionVector` to not interfere with raycasting in 2D
         // v radians
         void setDirectionAngle(float _angle) {
-            directionAngle  = std::fmodf(_angle, 2 * fPi);
-            directionVector = XMVECTOR{ std::cosf(directionAngle), std::sinf(directionAngle), 0.f, 0.f };
+            updateDirection(_angle);
             spdlog::info("angle: {}, dirx: {}, diry: {}\n",
                          directionAngle,
                          XMVectorGetX(directionVector),
@@ -180,9 +181,9 @@ public:
         }
 
         // v radians
-        const float getFov() const { return fov; }
+        float getFov() const { return fov; }
         // v radians
-        const float getVfov() const { return vfov; }
+        float getVfov() const { return vfov; }
 
         // v image plane width is 1
         float getImagePlaneDistance() const { return imagePlaneDistance; }
@@ -190,15 +191,20 @@ public:
         void  setPitch(float _pitch) { pitch = _pitch; }
         float getPitch() const { return pitch; }
 
-        void interpolate(const Camera& c1, const Camera& c2, float alpha) {
-            position  = XMVectorLerp(c1.position, c2.position, alpha);
-            camHeight = c1.camHeight * (1.f - alpha) + c2.camHeight * alpha;
-
-            setDirectionAngle(c1.directionAngle * (1.f - alpha) + c2.directionAngle * alpha);
-            pitch = c1.pitch * (1.f - alpha) + c2.pitch * alpha;
+        /// As setting each of them, for the per frame blend of ScenePose, so without logging
+        void setPose(const XMVECTOR& _position, float _camHeight, float _directionAngle, float _pitch) {
+            position  = _position;
+            camHeight = _camHeight;
+            pitch     = _pitch;
+            updateDirection(_directionAngle);
         }
 
     private:
+        void updateDirection(float _angle) {
+            directionAngle  = std::fmod(_angle, 2 * fPi);
+            directionVector = XMVECTOR{ std::cos(directionAngle), std::sin(directionAngle), 0.f, 0.f };
+        }
+
         // directionVector and directionAngle represent the same thing, we keep both for caching
         XMVECTOR directionVector{ 0, -1, 0, 0 }; //< 2D normalized vector, representing angle
         float    fov;                            //< radians
@@ -211,3 +217,115 @@ public:
 
     } camera;
 };
+
+/// Compiles the character map in `fileName` into `state`'s tiles and puts `scene`'s camera on its '@'.
+/// \throws std::runtime_error or std::system_error if the file can not be read, see also TileMap::compile
+inline void loadMapFile(const std::string& fileName, GameplayState& state, GJScene& scene) {
+    state.fileName = fileName;
+    std::string line;
+
+    namespace fs = std::filesystem;
+    fs::path p{ fileName };
+
+    if (!fs::exists(p)) {
+        throw std::runtime_error("Cannot open map file '" + fileName + "': file does not exist");
+    }
+    if (!fs::is_regular_file(p)) {
+        throw std::runtime_error("Cannot open map file '" + fileName + "': not a regular file");
+    }
+
+    std::ifstream f;
+    f.open(fileName, std::ios::in | std::ios::binary);
+    if (!f.is_open()) {
+        int err = errno;
+        throw std::system_error(err, std::generic_category(), "Failed to open map file " + fileName);
+    }
+
+    std::vector<std::string> rows;
+    while (f.peek() != EOF) {
+        getline(f, line);
+        // remove any '\r' left by Windows line endings
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        size_t findPlayer = line.find('@');
+        if (findPlayer != std::string::npos) {
+            scene.camera.position =
+                XMVECTOR{ static_cast<float>(findPlayer) + 0.5f, static_cast<float>(rows.size() + 1) + 0.5f, 0, 0 };
+            line[findPlayer] = ' ';
+        }
+        rows.push_back(line);
+    }
+    state.tiles.compile(rows);
+    state.width  = state.tiles.getWidth();
+    state.height = state.tiles.getHeight();
+}
+
+/// The fields of GJScene that move between ticks. The simulation keeps the two latest, which the render thread blends
+/// into the scene it draws, see SceneSnapshot
+struct ScenePose {
+    struct Body {
+        XMVECTOR position{};
+        float    size   = 2.f;
+        uint16_t health = 1; //< not blended, taken from the later pose
+    };
+
+    void capture(const GJScene& scene) {
+        for (size_t i = 0; i < entities.size(); ++i) {
+            entities[i] = { scene.entities[i].position, scene.entities[i].size, scene.entities[i].health };
+        }
+        for (size_t i = 0; i < obstacles.size(); ++i) {
+            obstacles[i] = { scene.obstacles[i].position, scene.obstacles[i].size, scene.obstacles[i].health };
+        }
+        cameraPosition = scene.camera.position;
+        camHeight      = scene.camera.camHeight;
+        directionAngle = scene.camera.getDirectionAngle();
+        pitch          = scene.camera.getPitch();
+    }
+
+    /// Writes the pose `alpha` [0..1] of the way from `from` to `to` into `scene`. The camera turns the short way round
+    static void blend(const ScenePose& from, const ScenePose& to, float alpha, GJScene& scene) {
+        auto lerp = [alpha](float a, float b) { return a + (b - a) * alpha; };
+        auto body = [alpha, &lerp](Entity& e, const Body& b1, const Body& b2) {
+            e.position = XMVectorLerp(b1.position, b2.position, alpha);
+            e.size     = lerp(b1.size, b2.size);
+            e.health   = b2.health;
+        };
+        for (size_t i = 0; i < from.entities.size(); ++i) {
+            body(scene.entities[i], from.entities[i], to.entities[i]);
+        }
+        for (size_t i = 0; i < from.obstacles.size(); ++i) {
+            body(scene.obstacles[i], from.obstacles[i], to.obstacles[i]);
+        }
+        const float turn = std::remainder(to.directionAngle - from.directionAngle, 2 * fPi);
+        scene.camera.setPose(XMVectorLerp(from.cameraPosition, to.cameraPosition, alpha),
+                             lerp(from.camHeight, to.camHeight),
+                             from.directionAngle + turn * alpha,
+                             lerp(from.pitch, to.pitch));
+    }
+
+    std::array<Body, std::tuple_size_v<decltype(GJScene::entities)>>  entities{};
+    std::array<Body, std::tuple_size_v<decltype(GJScene::obstacles)>> obstacles{};
+    XMVECTOR                                                          cameraPosition{};
+    float                                                             camHeight      = 0.f;
+    float                                                             directionAngle = 0.f; //< radians
+    float                                                             pitch          = 0.f; //< radians
+};
+
+/// What the simulation hands to the render thread after a tick, see GameEngine::publishSnapshot
+struct SceneSnapshot {
+    /// \return how far from `previous` to `current` the scene is at `now` [0..1], assuming ticks keep their length
+    float getAlpha(TimePoint now) const {
+        if (tickLength <= Seconds{ 0 }) {
+            return 1.f;
+        }
+        return std::clamp(toF((now - tickTime) / tickLength), 0.f, 1.f);
+    }
+
+    ScenePose      previous;
+    ScenePose      current;
+    GameplayStatus status;
+    TimePoint      tickTime;   //< when `current` was published
+    Seconds        tickLength; //< simulated time between `previous` and `current`
+};
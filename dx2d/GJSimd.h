@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+
+// Runtime ISA detection for the SIMD kernels. Kernels are compiled for their ISA with GJ_TARGET_* regardless of the
+// project-wide /arch, and selected at runtime with getSimdLevel().
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#   define GJ_SIMD_X86 1
+#   include <immintrin.h>
+#   if defined(_MSC_VER) && !defined(__clang__)
+#      include <intrin.h>
+#   endif
+#else
+#   define GJ_SIMD_X86 0
+#endif
+
+#if GJ_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#   define GJ_TARGET_SSE41 __attribute__((target("sse4.1")))
+#   define GJ_TARGET_AVX2  __attribute__((target("avx2,fma")))
+#else
+#   define GJ_TARGET_SSE41 // MSVC emits any intrinsic without /arch
+#   define GJ_TARGET_AVX2
+#endif
+
+/// Keeps a kernel's separate multiplies and adds apart, so it rounds like its scalar fallback. GCC fuses them into FMAs
+/// by default wherever the target has FMA, as GJ_TARGET_AVX2 kernels do; MSVC and clang only fuse when asked to
+/// (/fp:contract, /fp:fast, -ffp-contract=fast).
+#if GJ_SIMD_X86 && defined(__GNUC__) && !defined(__clang__)
+#   define GJ_NO_FP_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#   define GJ_NO_FP_CONTRACT
+#endif
+
+/// AVX2 stands for AVX2 and FMA, which every AVX2 CPU so far also has, see GJ_TARGET_AVX2
+enum class SimdLevel : uint8_t { Scalar = 0, SSE41, AVX2 };
+
+inline SimdLevel detectSimdLevel() {
+#if GJ_SIMD_X86
+#   if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse41   = info[2] & (1 << 19);
+    const bool osxsave = info[2] & (1 << 27);
+    const bool fma     = info[2] & (1 << 12);
+    const bool avx     = info[2] & (1 << 28);
+
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) { // OS saves the YMM registers
+        __cpuidex(info, 7, 0);
+        avx2 = info[1] & (1 << 5);
+    }
+#   else
+    __builtin_cpu_init();
+    const bool sse41 = __builtin_cpu_supports("sse4.1");
+    const bool fma   = __builtin_cpu_supports("fma");
+    const bool avx2  = __builtin_cpu_supports("avx2");
+#   endif
+    if (avx2 && fma) { // GJ_TARGET_AVX2 kernels use FMA too
+        return SimdLevel::AVX2;
+    }
+    if (sse41) {
+        return SimdLevel::SSE41;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+/// Widest ISA supported by this CPU, detected once.
+inline SimdLevel getSimdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
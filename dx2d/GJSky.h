@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "GJPalette.h"
+#include "GJRaster.h"
+
+// Procedural sky above the horizon. Free of DirectX / Windows dependencies.
+
+/// Sky colors by row distance above the horizon. The gradient depends only on the viewport height; pitching the
+/// camera moves the horizon, which only offsets where the cached colors land.
+class SkyGradient {
+public:
+    bool isValidFor(uint32_t _viewportHeight) const { return viewportHeight == _viewportHeight; }
+
+    /// Geometric bands, from a 1 pixel band at the horizon up to a top band of 30% of the viewport height.
+    void rebuild(uint32_t _viewportHeight) {
+        viewportHeight = _viewportHeight;
+        colors.resize(viewportHeight);
+
+        float topBandHeight = 0.3f * float(viewportHeight);
+        int   r_top         = 200;
+        int   g_top         = 150;
+        int   b_top         = 150;
+        int   r_min         = 50;
+        int   g_min         = 25;
+        int   b_min         = 25;
+        // Compute the geometric factor f so that (h0 - f) / (1 - f) == horizon.
+        // Derived from:
+        //   Sum S = (topBandHeight - f)/(1 - f)  must equal horizon.
+        float f = (float(viewportHeight) - topBandHeight) / (float(viewportHeight) - 1.f);
+
+        // Compute the (non-integer) number of bands so that last band = 1 pixel:
+        float Nf = 1 + std::log(1.0f / topBandHeight) / std::log(f);
+        assert(Nf > 0.f);
+        uint32_t N = uint32_t(std::ceil(Nf));
+
+        // band N sits on the horizon, band 0 at the top. Rows past band 0 keep its color
+        size_t row = 0;
+        for (int64_t i = N; row < colors.size(); i = std::max<int64_t>(i - 1, 0)) {
+            // Compute this band's height (using the geometric progression)
+            float bandHeightF = topBandHeight * std::pow(f, float(i));
+            int   bandHeight  = std::max(1, int(std::round(bandHeightF)));
+
+            // Compute color interpolation factor (0 at top, 1 at bottom)
+            float    t     = (N > 1) ? float(i) / float(N - 1) : 0.f;
+            uint8_t  r     = uint8_t(std::round(r_top + t * (r_min - r_top)));
+            uint8_t  g     = uint8_t(std::round(g_top + t * (g_min - g_top)));
+            uint8_t  b     = uint8_t(std::round(b_top + t * (b_min - b_top)));
+            uint32_t color = (0xFF << 24) | (r << 16) | (g << 8) | b;
+
+            const size_t end = std::min(colors.size(), row + size_t(bandHeight));
+            std::fill(colors.begin() + row, colors.begin() + end, color);
+            row = end;
+        }
+        indices.clear();
+    }
+
+    /// For the indexed render mode: the palette index of every color, until the next rebuild
+    void quantize(const Palette& palette) {
+        indices.resize(colors.size());
+        std::transform(colors.begin(), colors.end(), indices.begin(), [&palette](uint32_t c) { return palette.nearest(c); });
+    }
+
+    /// BGRA, by rows above the horizon
+    const std::vector<uint32_t>& getColors() const { return colors; }
+
+    /// Fills rows [rowBegin, rowEnd) of the frame with the sky color of their height above `horizonRow`.
+    /// \param horizonRow the row that gets the horizon color, >= rowEnd - 1
+    /// \tparam Pixel uint8_t for an IndexedFrameView, after quantize()
+    template <typename Pixel>
+    void fill(const BasicFrameView<Pixel>& frame, int32_t horizonRow, int32_t rowBegin, int32_t rowEnd) const {
+        rowBegin = std::max(rowBegin, 0);
+        rowEnd   = std::min(rowEnd, int32_t(frame.height));
+        for (int32_t y = rowBegin; y < rowEnd; ++y) {
+            if constexpr (sizeof(Pixel) == 1) {
+                std::fill_n(frame.row(uint32_t(y)), frame.width, indices[size_t(horizonRow - y)]);
+            } else {
+                std::fill_n(frame.row(uint32_t(y)), frame.width, colors[size_t(horizonRow - y)]);
+            }
+        }
+    }
+
+private:
+    uint32_t              viewportHeight = 0;
+    std::vector<uint32_t> colors;  //< colors[0] is the horizon row
+    std::vector<uint8_t>  indices; //< of colors, see quantize
+};
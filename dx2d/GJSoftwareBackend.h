@@ -0,0 +1,215 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "GJRaster.h"
+#include "GJRenderBackend.h"
+#include "stb_image.h"
+
+// Headless RenderBackend: draws into BGRA buffers in memory, so the renderer can run, be timed and have its frames
+// compared on machines without a GPU or a window. Free of DirectX / Windows dependencies. Decodes with the bundled
+// stb_image, whose implementation one translation unit must compile (STB_IMAGE_IMPLEMENTATION).
+
+/// Premultiplied `src` over premultiplied `dst`, per channel
+inline uint32_t overBGRA(uint32_t dst, uint32_t src) {
+    const uint32_t inverse = 255 - (src >> 24);
+    uint32_t       result  = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        const uint32_t channel = ((src >> shift) & 0xFF) + (((dst >> shift) & 0xFF) * inverse + 127) / 255;
+        result |= std::min(channel, 255U) << shift;
+    }
+    return result;
+}
+
+/// Writes `frame` as a binary PPM, without alpha. \throws std::runtime_error if the file can not be written
+inline void writePPM(const FrameView& frame, const std::filesystem::path& path) {
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << frame.width << ' ' << frame.height << "\n255\n";
+    std::vector<char> rgb(size_t(frame.width) * 3);
+    for (uint32_t y = 0; y < frame.height; ++y) {
+        const uint32_t* row = frame.row(y);
+        for (uint32_t x = 0; x < frame.width; ++x) {
+            rgb[x * 3 + 0] = char((row[x] >> 16) & 0xFF);
+            rgb[x * 3 + 1] = char((row[x] >> 8) & 0xFF);
+            rgb[x * 3 + 2] = char(row[x] & 0xFF);
+        }
+        file.write(rgb.data(), std::streamsize(rgb.size()));
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write " + path.string());
+    }
+}
+
+/// Draws like D2DBackend, aliased and nearest neighbor, into premultiplied BGRA buffers. The window is UPSCALE times
+/// the low res target, which fills it. Text is left out: there is no font rasterizer to draw it with.
+class SoftwareBackend final : public RenderBackend {
+public:
+    static constexpr uint32_t UPSCALE = 2; //< as D2DBackend
+
+    /// \param _width, _height of the low res target
+    SoftwareBackend(uint32_t _width, uint32_t _height)
+        : width(_width)
+        , height(_height)
+        , lowRes(size_t(_width) * _height, 0)
+        , window(size_t(_width) * _height * UPSCALE * UPSCALE, 0xFF000000) {}
+
+    uint32_t getWidth() const override { return width; }
+    uint32_t getHeight() const override { return height; }
+
+    void beginFrame() override {
+        std::fill(window.begin(), window.end(), 0xFF000000);
+        std::fill(lowRes.begin(), lowRes.end(), 0);
+    }
+
+    void endFrame() override {
+        const FrameView target = getFrame();
+        for (uint32_t y = 0; y < target.height; ++y) {
+            const uint32_t* from = getLowResFrame().row(y / UPSCALE);
+            uint32_t*       to   = target.row(y);
+            for (uint32_t x = 0; x < target.width; ++x) {
+                to[x] = overBGRA(to[x], from[x / UPSCALE]);
+            }
+        }
+    }
+
+    bool presentWaitedForVsync() const override { return false; }
+
+    void resize() override {}
+
+    void fillRectangle(const RectF& rect, ColorF color, DrawTarget target) override {
+        const FrameView frame = target == DrawTarget::Window ? getFrame() : getLowResFrame();
+        const uint32_t  src   = premultiply(color);
+        const PixelRect area  = clip(frame, rect);
+        for (int32_t y = area.top; y < area.bottom; ++y) {
+            uint32_t* row = frame.row(uint32_t(y));
+            for (int32_t x = area.left; x < area.right; ++x) {
+                row[x] = overBGRA(row[x], src);
+            }
+        }
+    }
+
+    void drawLine(float x0, float y0, float x1, float y1, ColorF color, float strokeWidth) override {
+        // one square of strokeWidth per pixel step along the longer axis
+        const float steps = std::max(std::ceil(std::max(std::abs(x1 - x0), std::abs(y1 - y0))), 1.f);
+        const float half  = std::max(strokeWidth, 1.f) / 2.f;
+        for (float i = 0.f; i <= steps; ++i) {
+            const float x = x0 + (x1 - x0) * i / steps;
+            const float y = y0 + (y1 - y0) * i / steps;
+            fillRectangle({ x - half, y - half, x + half, y + half }, color, DrawTarget::LowRes);
+        }
+    }
+
+    void drawText(std::wstring_view, TextFormat, const RectF&, ColorF, DrawTarget) override {}
+
+    CPUBitmap decodeImage(const std::filesystem::path& path) override {
+        int            imageWidth  = 0;
+        int            imageHeight = 0;
+        int            channels    = 0;
+        stbi_uc* const rgba        = stbi_load(path.string().c_str(), &imageWidth, &imageHeight, &channels, 4);
+        if (!rgba) {
+            throw std::runtime_error("Failed to load image " + path.string() + ": " + stbi_failure_reason());
+        }
+        CPUBitmap bitmap = { .width = size_t(imageWidth), .height = size_t(imageHeight), .channels = 4 };
+        bitmap.data.assign(rgba, rgba + size_t(imageWidth) * size_t(imageHeight) * 4);
+        stbi_image_free(rgba);
+        for (size_t i = 0; i < bitmap.data.size(); i += 4) {
+            std::swap(bitmap.data[i], bitmap.data[i + 2]); //< RGBA to BGRA
+        }
+        return bitmap;
+    }
+
+    void loadImage(EGPUBitmap image, const std::filesystem::path& path) override {
+        CPUBitmap& bitmap = images[static_cast<size_t>(image)];
+        bitmap            = decodeImage(path);
+        for (size_t i = 0; i < bitmap.data.size(); i += 4) {
+            for (size_t c = 0; c < 3; ++c) {
+                bitmap.data[i + c] = uint8_t((bitmap.data[i + c] * bitmap.data[i + 3] + 127) / 255);
+            }
+        }
+    }
+
+    void createImage(EGPUBitmap image, uint32_t imageWidth, uint32_t imageHeight) override {
+        images[static_cast<size_t>(image)] = { .width    = imageWidth,
+                                               .height   = imageHeight,
+                                               .channels = 4,
+                                               .data     = std::vector<uint8_t>(size_t(imageWidth) * imageHeight * 4, 0) };
+    }
+
+    void updateImage(EGPUBitmap image, const uint32_t* pixels, uint32_t top, uint32_t bottom) override {
+        CPUBitmap&   bitmap   = images[static_cast<size_t>(image)];
+        const size_t rowBytes = bitmap.width * 4;
+        std::memcpy(bitmap.data.data() + top * rowBytes, pixels + top * bitmap.width, (bottom - top) * rowBytes);
+    }
+
+    SizeF getImageSize(EGPUBitmap image) const override {
+        const CPUBitmap& bitmap = images[static_cast<size_t>(image)];
+        return { float(bitmap.width), float(bitmap.height) };
+    }
+
+    void drawImage(EGPUBitmap image, const RectF& dest) override {
+        const CPUBitmap& bitmap = images[static_cast<size_t>(image)];
+        blit(bitmap.texels(), uint32_t(bitmap.width), uint32_t(bitmap.height), dest, true);
+    }
+
+    /// The 3D view is opaque, so its pixels are copied rather than blended
+    void drawPixels(const uint32_t* pixels, uint32_t pixelsWidth, uint32_t pixelsHeight, const RectF& dest) override {
+        blit(pixels, pixelsWidth, pixelsHeight, dest, false);
+    }
+
+    /// The window as presented by the last endFrame
+    FrameView getFrame() { return { window.data(), width * UPSCALE, height * UPSCALE }; }
+
+    FrameView getLowResFrame() { return { lowRes.data(), width, height }; }
+
+private:
+    /// Pixels whose centers lie in a rectangle, clipped to the frame
+    struct PixelRect {
+        int32_t left;
+        int32_t top;
+        int32_t right; //< exclusive
+        int32_t bottom;
+    };
+
+    static PixelRect clip(const FrameView& frame, const RectF& rect) {
+        auto toPixel = [](float v, uint32_t size) { return int32_t(std::ceil(std::clamp(v - 0.5f, 0.f, float(size)))); };
+        return { toPixel(rect.left, frame.width),
+                 toPixel(rect.top, frame.height),
+                 toPixel(rect.right, frame.width),
+                 toPixel(rect.bottom, frame.height) };
+    }
+
+    static uint32_t premultiply(ColorF color) {
+        return packBGRA(color.r * color.a, color.g * color.a, color.b * color.a, color.a);
+    }
+
+    /// `source` stretched over `dest` of the low res target, nearest neighbor
+    void blit(const uint32_t* source, uint32_t sourceWidth, uint32_t sourceHeight, const RectF& dest, bool blend) {
+        const FrameView frame  = getLowResFrame();
+        const PixelRect area   = clip(frame, dest);
+        const float     scaleX = float(sourceWidth) / (dest.right - dest.left);
+        const float     scaleY = float(sourceHeight) / (dest.bottom - dest.top);
+        for (int32_t y = area.top; y < area.bottom; ++y) {
+            const uint32_t  v   = std::min(uint32_t((float(y) + 0.5f - dest.top) * scaleY), sourceHeight - 1);
+            const uint32_t* src = source + size_t(v) * sourceWidth;
+            uint32_t*       row = frame.row(uint32_t(y));
+            for (int32_t x = area.left; x < area.right; ++x) {
+                const uint32_t u = std::min(uint32_t((float(x) + 0.5f - dest.left) * scaleX), sourceWidth - 1);
+                row[x]           = blend ? overBGRA(row[x], src[u]) : src[u];
+            }
+        }
+    }
+
+    uint32_t                                                     width;
+    uint32_t                                                     height;
+    std::vector<uint32_t>                                        lowRes;
+    std::vector<uint32_t>                                        window;
+    std::array<CPUBitmap, static_cast<size_t>(EGPUBitmap::size)> images = {};
+};
@@ -0,0 +1,138 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Billboard sprite projection, culling and sorting. Free of DirectX / Windows dependencies.
+
+/// A camera-facing billboard standing on the floor.
+struct Sprite {
+    float    x;
+    float    y;
+    float    width;     //< world units
+    float    height;    //< world units
+    uint16_t textureId; //< see GJRenderer::spriteTextures
+};
+
+/// What the sprite pass needs to know about the camera.
+struct SpriteView {
+    float    camX;
+    float    camY;
+    float    dirX;               //< normalized view direction
+    float    dirY;               //< normalized view direction
+    float    imagePlaneDistance; //< for an image plane of width 1, see GJScene::Camera::getImagePlaneDistance
+    uint32_t viewportWidth;
+    float    nearDist;
+    float    farDist;
+};
+
+struct ProjectedSprite {
+    float    depth;       //< perpendicular to the image plane, comparable to the wall depth buffer
+    float    screenLeft;  //< pixels, may be negative
+    float    screenWidth; //< pixels
+    uint32_t index;       //< into the culled sprite span
+};
+
+/// Columns [begin, end) a sprite covers on screen.
+struct SpriteColumns {
+    uint32_t begin = 0;
+    uint32_t end   = 0; //< exclusive
+};
+
+/// Projects sprites to screen space, rejects those behind the camera, outside the FOV or beyond farDist, sorts the rest
+/// back to front and bins them by the columns they cover, so a strip of columns visits only its own sprites. Storage is
+/// reused between frames: after the first frames, culling does not allocate.
+class SpriteCuller {
+public:
+    /// \param _binWidth columns per bin, see getBin
+    void cull(std::span<const Sprite> sprites, const SpriteView& view, uint32_t _binWidth) {
+        visible.clear();
+        if (visible.capacity() < sprites.size()) {
+            visible.reserve(sprites.size());
+        }
+
+        // camera space: x along the view direction, y to the right of the screen (see ColumnRayTable)
+        const float rightX         = -view.dirY;
+        const float rightY         = view.dirX;
+        const float pixelsPerSlope = view.imagePlaneDistance * float(view.viewportWidth);
+        const float halfWidth      = float(view.viewportWidth / 2);
+
+        for (uint32_t i = 0; i < sprites.size(); ++i) {
+            const Sprite& s     = sprites[i];
+            const float   relX  = s.x - view.camX;
+            const float   relY  = s.y - view.camY;
+            const float   depth = relX * view.dirX + relY * view.dirY;
+            if (depth < view.nearDist || depth > view.farDist) {
+                continue;
+            }
+
+            const float lateral     = relX * rightX + relY * rightY;
+            const float screenX     = halfWidth + (lateral / depth) * pixelsPerSlope;
+            const float screenWidth = (s.width / depth) * pixelsPerSlope;
+            const float screenLeft  = screenX - screenWidth / 2.f;
+            if (screenLeft + screenWidth <= 0.f || screenLeft >= float(view.viewportWidth)) {
+                continue;
+            }
+            visible.push_back({ depth, screenLeft, screenWidth, i });
+        }
+
+        std::sort(visible.begin(), visible.end(), [](const ProjectedSprite& a, const ProjectedSprite& b) {
+            return a.depth > b.depth;
+        });
+        binVisible(std::max<uint32_t>(_binWidth, 1), view.viewportWidth);
+    }
+
+    /// Back to front, valid until the next cull()
+    const std::vector<ProjectedSprite>& getVisible() const { return visible; }
+
+    /// Columns whose centers lie in [screenLeft, screenLeft + screenWidth), clamped to [0, viewportWidth)
+    static SpriteColumns getColumns(const ProjectedSprite& p, uint32_t viewportWidth) {
+        const int32_t begin = std::max(0, int32_t(std::ceil(p.screenLeft - 0.5f)));
+        const int32_t end   = std::min(int32_t(viewportWidth), int32_t(std::ceil(p.screenLeft + p.screenWidth - 0.5f)));
+        return { uint32_t(begin), uint32_t(std::max(begin, end)) };
+    }
+
+    uint32_t getBinWidth() const { return binWidth; }
+
+    /// Indices into getVisible() of the sprites covering a column of [bin * binWidth, (bin + 1) * binWidth), back to
+    /// front. Valid until the next cull()
+    std::span<const uint32_t> getBin(uint32_t bin) const {
+        if (bin + 1 >= binStarts.size()) {
+            return {};
+        }
+        return { binned.data() + binStarts[bin], binned.data() + binStarts[bin + 1] };
+    }
+
+private:
+    /// Counting sort of the visible sprites into the bins they cover, keeping them back to front within each bin
+    void binVisible(uint32_t _binWidth, uint32_t viewportWidth) {
+        binWidth = _binWidth;
+        binStarts.assign((viewportWidth + binWidth - 1) / binWidth + 1, 0);
+        for (const ProjectedSprite& p : visible) {
+            const SpriteColumns columns = getColumns(p, viewportWidth);
+            for (uint32_t bin = columns.begin / binWidth; columns.begin < columns.end && bin * binWidth < columns.end; ++bin) {
+                ++binStarts[bin + 1];
+            }
+        }
+        for (size_t bin = 1; bin < binStarts.size(); ++bin) {
+            binStarts[bin] += binStarts[bin - 1];
+        }
+
+        binned.resize(binStarts.back());
+        binFill.assign(binStarts.begin(), binStarts.end() - 1);
+        for (uint32_t i = 0; i < visible.size(); ++i) {
+            const SpriteColumns columns = getColumns(visible[i], viewportWidth);
+            for (uint32_t bin = columns.begin / binWidth; columns.begin < columns.end && bin * binWidth < columns.end; ++bin) {
+                binned[binFill[bin]++] = i;
+            }
+        }
+    }
+
+    std::vector<ProjectedSprite> visible;
+    uint32_t                     binWidth = 1;
+    std::vector<uint32_t>        binStarts; //< per bin, into binned; one more at the end
+    std::vector<uint32_t>        binned;    //< indices into visible, bin after bin
+    std::vector<uint32_t>        binFill;   //< per bin, while binning
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// CPU-side textures. Free of DirectX / Windows dependencies; decoding happens in the render backend, see GJRenderBackend.h
+
+enum class TexelLayout : uint8_t {
+    RowMajor,    //< texel (x, y) at y * width + x. What decoders produce; used for floors
+    ColumnMajor, //< texel (x, y) at x * height + y. Used for walls, which are drawn one texture column at a time
+};
+
+struct MipLevel {
+    size_t width;
+    size_t height;
+    size_t offset; //< in texels, into CPUBitmap::data
+};
+
+struct CPUBitmap {
+    size_t                width    = 0;
+    size_t                height   = 0;
+    uint8_t               channels = 0;
+    std::vector<uint8_t>  data     = {}; //< level 0 followed by the rest of the mip chain, if generated
+    TexelLayout           layout   = TexelLayout::RowMajor;
+    std::vector<MipLevel> mips     = {}; //< empty until generateMips(); mips[0] is the full size bitmap
+
+    /// \return byte offset of texel (x, y) of level 0
+    size_t getPixel(size_t x, size_t y) const { return texelIndex(x, y, width, height) * channels; }
+
+    /// 4 channel bitmaps only
+    const uint32_t* texels(size_t level = 0) const {
+        return reinterpret_cast<const uint32_t*>(data.data()) + (mips.empty() ? 0 : mips[level].offset);
+    }
+
+    /// ColumnMajor only: the contiguous texels of column x of `level`, top to bottom
+    const uint32_t* column(size_t x, size_t level = 0) const { return texels(level) + x * getMip(level).height; }
+
+    /// 1 channel (palette indexed) bitmaps only, see Palette::quantize
+    const uint8_t* indices(size_t level = 0) const { return data.data() + (mips.empty() ? 0 : mips[level].offset); }
+
+    /// ColumnMajor, 1 channel bitmaps only: like column()
+    const uint8_t* indexColumn(size_t x, size_t level = 0) const { return indices(level) + x * getMip(level).height; }
+
+    MipLevel getMip(size_t level) const { return mips.empty() ? MipLevel{ width, height, 0 } : mips[level]; }
+    size_t   getMipCount() const { return std::max<size_t>(1, mips.size()); }
+
+    /// Mip level whose texels best match the screen pixels they are drawn to.
+    /// \param texelsPerPixel at level 0, along the most minified axis
+    size_t selectMip(float texelsPerPixel) const {
+        if (!(texelsPerPixel > 1.f)) {
+            return 0;
+        }
+        return std::min(size_t(std::log2(texelsPerPixel)), getMipCount() - 1);
+    }
+
+    /// Discards any mip chain, call generateMips() again afterwards.
+    void setLayout(TexelLayout newLayout) {
+        dropMips();
+        if (newLayout == layout) {
+            return;
+        }
+        std::vector<uint8_t> transposed(data.size());
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                const size_t from = getPixel(x, y);
+                const size_t to   = (newLayout == TexelLayout::RowMajor ? y * width + x : x * height + y) * channels;
+                for (size_t c = 0; c < channels; ++c) {
+                    transposed[to + c] = data[from + c];
+                }
+            }
+        }
+        data   = std::move(transposed);
+        layout = newLayout;
+    }
+
+    /// Appends 2x2 box filtered levels down to 1x1, in the bitmap's current layout. 4 channel bitmaps are straight alpha
+    /// BGRA: their color is weighted by alpha (premultiplied, averaged, divided again), so the color of transparent texels
+    /// does not bleed into the edges of sprites.
+    void generateMips() {
+        dropMips();
+        mips.push_back({ width, height, 0 });
+        while (mips.back().width > 1 || mips.back().height > 1) {
+            const MipLevel src = mips.back();
+            const MipLevel dst = { std::max<size_t>(1, src.width / 2),
+                                   std::max<size_t>(1, src.height / 2),
+                                   src.offset + src.width * src.height };
+            data.resize((dst.offset + dst.width * dst.height) * channels);
+
+            for (size_t y = 0; y < dst.height; ++y) {
+                for (size_t x = 0; x < dst.width; ++x) {
+                    // clamp so odd / 1 texel wide sources still work
+                    const size_t x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+                    const size_t y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+
+                    const std::array<size_t, 4> from = { (src.offset + texelIndex(x0, y0, src.width, src.height)) * channels,
+                                                         (src.offset + texelIndex(x1, y0, src.width, src.height)) * channels,
+                                                         (src.offset + texelIndex(x0, y1, src.width, src.height)) * channels,
+                                                         (src.offset + texelIndex(x1, y1, src.width, src.height)) * channels };
+                    const size_t                to   = (dst.offset + texelIndex(x, y, dst.width, dst.height)) * channels;
+                    if (channels == 4) {
+                        averageStraightAlpha(from, to);
+                    } else {
+                        for (size_t c = 0; c < channels; ++c) {
+                            const uint32_t sum = data[from[0] + c] + data[from[1] + c] + data[from[2] + c] + data[from[3] + c];
+                            data[to + c]       = uint8_t((sum + 2) / 4);
+                        }
+                    }
+                }
+            }
+            mips.push_back(dst);
+        }
+    }
+
+private:
+    size_t texelIndex(size_t x, size_t y, size_t levelWidth, size_t levelHeight) const {
+        return layout == TexelLayout::RowMajor ? y * levelWidth + x : x * levelHeight + y;
+    }
+
+    /// Writes the BGRA texel at byte offset `to` as the alpha weighted average of the 4 at `from`. Where all 4 are
+    /// transparent, the color is their plain average
+    void averageStraightAlpha(const std::array<size_t, 4>& from, size_t to) {
+        uint32_t alpha = 0;
+        for (size_t f : from) {
+            alpha += data[f + 3];
+        }
+        for (size_t c = 0; c < 3; ++c) {
+            uint32_t weighted = 0;
+            uint32_t plain    = 0;
+            for (size_t f : from) {
+                weighted += uint32_t(data[f + c]) * data[f + 3];
+                plain += data[f + c];
+            }
+            data[to + c] = uint8_t(alpha ? (weighted + alpha / 2) / alpha : (plain + 2) / 4);
+        }
+        data[to + 3] = uint8_t((alpha + 2) / 4);
+    }
+
+    void dropMips() {
+        if (!mips.empty()) {
+            data.resize(width * height * channels);
+            mips.clear();
+        }
+    }
+};
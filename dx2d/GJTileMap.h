@@ -0,0 +1,136 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Compiled tile representation of a character map. Like GJRaycast.h, free of DirectX / Windows dependencies.
+
+constexpr uint8_t NO_CEILING = 0xFF; //< TileAttributes::ceilingTextureId of open-air tiles
+
+/// Per tile-type attributes. Kept to a few bytes so the whole table fits in a single cache line.
+struct TileAttributes {
+    uint8_t textureId        = 0;          //< index into the renderer's wall textures
+    uint8_t transparency     = 0;          //< 0 = opaque. Otherwise rays continue behind the tile, which blends in with
+                                           //< opacity 255 - transparency and is fully see-through where its texture's alpha
+                                           //< is < 128
+    uint8_t height           = 0;          //< wall height in 1/255 world units. 0 = no wall
+    uint8_t ceilingTextureId = NO_CEILING; //< texture of the ceiling above the tile, one world unit above the floor
+};
+
+enum class TileType : uint8_t { Empty = 0, Wall, Window, Grate, Indoor, size };
+
+struct TileTypeDesc {
+    char           glyph; //< character used in map files
+    TileAttributes attributes;
+};
+
+inline constexpr std::array<TileTypeDesc, static_cast<size_t>(TileType::size)> TILE_TYPES = { {
+    { ' ', { 0, 0, 0 } },    // Empty
+    { '#', { 0, 0, 255 } },  // Wall
+    { '=', { 5, 96, 255 } }, // Window
+    { '+', { 24, 1, 255 } }, // Grate: bars are practically opaque, the gaps come from the texture's alpha
+    { '.', { 0, 0, 0, 3 } }, // Indoor: empty, under a ceiling
+} };
+
+/// Raw view of TileMap's solidity bitmap, for the SIMD raycasters which index the words themselves.
+struct SolidGridView {
+    const uint64_t* words       = nullptr; //< bit x&63 of words[y * wordsPerRow + x / 64]
+    uint64_t        wordsPerRow = 0;
+    uint64_t        width       = 0;
+    uint64_t        height      = 0;
+    uint64_t        version     = 0; //< see TileMap::getVersion. 0 for grids not from a TileMap
+
+    bool isSolid(size_t x, size_t y) const { return (words[y * wordsPerRow + (x >> 6)] >> (x & 63)) & 1; }
+};
+
+/// 1 bit per cell solidity bitmap (rows padded to 64-bit words) + 1 byte per cell tile type. Raycasting, collision and
+/// minimap queries only ever need `isSolid`, which touches 64x less memory than the character map did.
+class TileMap {
+public:
+    /// \param rows character map, one string per row. Shorter rows are padded with empty tiles.
+    /// \throws std::runtime_error on characters not in TILE_TYPES
+    void compile(const std::vector<std::string>& rows) {
+        version = nextVersion();
+        height  = rows.size();
+        width  = 0;
+        for (const std::string& row : rows) {
+            width = std::max<uint64_t>(width, row.size());
+        }
+        wordsPerRow = (width + 63) / 64;
+
+        std::array<TileType, 256> typeFromGlyph;
+        std::array<bool, 256>     knownGlyph{};
+        for (size_t i = 0; i < TILE_TYPES.size(); ++i) {
+            const uint8_t glyph  = static_cast<uint8_t>(TILE_TYPES[i].glyph);
+            typeFromGlyph[glyph] = static_cast<TileType>(i);
+            knownGlyph[glyph]    = true;
+            attributes[i]        = TILE_TYPES[i].attributes;
+        }
+
+        ceilings   = false;
+        seeThrough = false;
+        solidBits.assign(wordsPerRow * height, 0);
+        types.assign(width * height, TileType::Empty);
+        for (size_t y = 0; y < height; ++y) {
+            for (size_t x = 0; x < rows[y].size(); ++x) {
+                const uint8_t glyph = static_cast<uint8_t>(rows[y][x]);
+                if (!knownGlyph[glyph]) {
+                    throw std::runtime_error("Unknown tile '" + std::string(1, rows[y][x]) + "' at row " + std::to_string(y) +
+                                             ", column " + std::to_string(x));
+                }
+                types[y * width + x] = typeFromGlyph[glyph];
+                ceilings   |= attributes[toIndex(typeFromGlyph[glyph])].ceilingTextureId != NO_CEILING;
+                seeThrough |= attributes[toIndex(typeFromGlyph[glyph])].transparency > 0;
+                if (attributes[toIndex(typeFromGlyph[glyph])].height > 0) {
+                    solidBits[y * wordsPerRow + (x >> 6)] |= uint64_t(1) << (x & 63);
+                }
+            }
+        }
+    }
+
+    bool isSolid(size_t x, size_t y) const { return (solidBits[y * wordsPerRow + (x >> 6)] >> (x & 63)) & 1; }
+
+    TileType getType(size_t x, size_t y) const { return types[y * width + x]; }
+
+    /// Solid, but rays continue behind it, see TileAttributes::transparency
+    bool isSeeThrough(size_t x, size_t y) const { return getAttributes(x, y).transparency > 0; }
+
+    const TileAttributes& getAttributes(size_t x, size_t y) const { return attributes[toIndex(getType(x, y))]; }
+
+    SolidGridView getSolidGrid() const { return { solidBits.data(), wordsPerRow, width, height, version }; }
+
+    /// Changes whenever the tiles do, and is unique across maps: two maps with the same version are copies of each other,
+    /// so whatever was derived from one is up to date for the other. 0 before the first compile
+    uint64_t getVersion() const { return version; }
+
+    /// Whether any tile has a ceiling, i.e. whether the ceiling pass is needed at all
+    bool hasCeilings() const { return ceilings; }
+
+    /// Whether any tile is see-through, i.e. whether walls ever need more than one layer
+    bool hasSeeThrough() const { return seeThrough; }
+
+    uint64_t getWidth() const { return width; }
+    uint64_t getHeight() const { return height; }
+
+private:
+    static size_t toIndex(TileType type) { return static_cast<size_t>(type); }
+
+    static uint64_t nextVersion() {
+        static std::atomic<uint64_t> last{ 0 };
+        return ++last;
+    }
+
+    uint64_t              width       = 0;
+    uint64_t              height      = 0;
+    uint64_t              wordsPerRow = 0;
+    uint64_t              version     = 0; //< see getVersion
+    bool                  ceilings    = false;
+    bool                  seeThrough  = false;
+    std::vector<uint64_t> solidBits; //< bit x&63 of word [y * wordsPerRow + x / 64]
+    std::vector<TileType> types;     //< row-major, width * height
+    std::array<TileAttributes, static_cast<size_t>(TileType::size)> attributes;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand over of values between two threads. Free of DirectX / Windows dependencies.
+
+/// Passes the newest of a stream of values from one producer thread to one consumer thread, without either ever
+/// waiting for the other. The producer fills back() and publishes it, the consumer takes the newest published value
+/// with update(). Values published while the consumer was busy are skipped. Slots are reused, so a T holding
+/// containers stops allocating once their capacities settle.
+template <typename T>
+class TripleBuffer {
+public:
+    /// Producer only. The slot to fill, holding an older value, which is not necessarily the last one published
+    T& back() { return slots[backIndex]; }
+
+    /// Producer only. Makes back() the newest value and hands the producer another slot
+    void publish() { backIndex = middle.exchange(uint8_t(backIndex | FRESH), std::memory_order_acq_rel) & INDEX; }
+
+    /// Consumer only. Moves front() to the newest published value
+    /// \return false if nothing was published since the last update, front() is then unchanged
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    /// Consumer only. Default constructed until the first update that returns true
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4; //< set in middle while it holds a value the consumer has not taken
+
+    std::array<T, 3>     slots{};
+    uint8_t              backIndex  = 0; //< producer's
+    uint8_t              frontIndex = 1; //< consumer's
+    std::atomic<uint8_t> middle     = 2; //< index of the slot in between | FRESH
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+// The vector math GJScene, GJRenderer and the benchmarks use. DirectXMath on Windows; elsewhere, where DirectXMath is
+// not installed, a scalar stand-in with DirectXMath's names and results for just that subset, so the renderer builds
+// headless.
+
+#if defined(_WIN32)
+#include <DirectXMath.h>
+#else
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace DirectX {
+
+struct alignas(16) XMVECTOR {
+    float v[4];
+};
+using FXMVECTOR = const XMVECTOR&;
+
+constexpr uint32_t XM_CRMASK_CR6TRUE  = 0x00000080;
+constexpr uint32_t XM_CRMASK_CR6FALSE = 0x00000020;
+
+inline XMVECTOR operator+(FXMVECTOR a, FXMVECTOR b) {
+    return { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] };
+}
+inline XMVECTOR operator-(FXMVECTOR a, FXMVECTOR b) {
+    return { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] };
+}
+inline XMVECTOR operator-(FXMVECTOR a) { return { -a.v[0], -a.v[1], -a.v[2], -a.v[3] }; }
+inline XMVECTOR operator*(FXMVECTOR a, float s) { return { a.v[0] * s, a.v[1] * s, a.v[2] * s, a.v[3] * s }; }
+inline XMVECTOR operator*(float s, FXMVECTOR a) { return a * s; }
+inline XMVECTOR& operator+=(XMVECTOR& a, FXMVECTOR b) { return a = a + b; }
+inline XMVECTOR& operator-=(XMVECTOR& a, FXMVECTOR b) { return a = a - b; }
+inline XMVECTOR& operator*=(XMVECTOR& a, float s) { return a = a * s; }
+
+inline float XMVectorGetX(FXMVECTOR a) { return a.v[0]; }
+inline float XMVectorGetY(FXMVECTOR a) { return a.v[1]; }
+inline float XMVectorGetZ(FXMVECTOR a) { return a.v[2]; }
+inline float XMVectorGetW(FXMVECTOR a) { return a.v[3]; }
+
+inline XMVECTOR XMVectorSetX(XMVECTOR a, float x) {
+    a.v[0] = x;
+    return a;
+}
+inline XMVECTOR XMVectorSetY(XMVECTOR a, float y) {
+    a.v[1] = y;
+    return a;
+}
+
+inline XMVECTOR XMVectorAbs(FXMVECTOR a) {
+    return { std::fabs(a.v[0]), std::fabs(a.v[1]), std::fabs(a.v[2]), std::fabs(a.v[3]) };
+}
+inline XMVECTOR XMVectorFloor(FXMVECTOR a) {
+    return { std::floor(a.v[0]), std::floor(a.v[1]), std::floor(a.v[2]), std::floor(a.v[3]) };
+}
+inline XMVECTOR XMVectorLerp(FXMVECTOR a, FXMVECTOR b, float t) { return a + (b - a) * t; }
+
+/// Divides all four components by the length of the first three. A zero length gives zero, as in DirectXMath
+inline XMVECTOR XMVector3Normalize(FXMVECTOR a) {
+    const float length = std::sqrt(a.v[0] * a.v[0] + a.v[1] * a.v[1] + a.v[2] * a.v[2]);
+    return a * (length > 0.f ? 1.f / length : 0.f);
+}
+inline XMVECTOR XMVector4Normalize(FXMVECTOR a) {
+    const float length = std::sqrt(a.v[0] * a.v[0] + a.v[1] * a.v[1] + a.v[2] * a.v[2] + a.v[3] * a.v[3]);
+    return a * (length > 0.f ? 1.f / length : 0.f);
+}
+
+/// \return true if every component of `a` is less than that of `b`
+inline bool XMVector4Less(FXMVECTOR a, FXMVECTOR b) {
+    return a.v[0] < b.v[0] && a.v[1] < b.v[1] && a.v[2] < b.v[2] && a.v[3] < b.v[3];
+}
+
+/// \return all ones per component of `a` greater than `b`. `*record` tells whether all or none were, see
+/// XMComparisonAllFalse
+inline XMVECTOR XMVectorGreaterR(uint32_t* record, FXMVECTOR a, FXMVECTOR b) {
+    XMVECTOR mask  = {};
+    uint32_t count = 0;
+    for (int i = 0; i < 4; ++i) {
+        const bool greater = a.v[i] > b.v[i];
+        mask.v[i]          = std::bit_cast<float>(greater ? 0xFFFFFFFFU : 0U);
+        count += greater;
+    }
+    *record = count == 4 ? XM_CRMASK_CR6TRUE : count == 0 ? XM_CRMASK_CR6FALSE : 0;
+    return mask;
+}
+inline bool XMComparisonAllFalse(uint32_t record) { return (record & XM_CRMASK_CR6FALSE) == XM_CRMASK_CR6FALSE; }
+
+/// Quaternions are (x, y, z, w), w the real part
+inline XMVECTOR XMQuaternionRotationAxis(FXMVECTOR axis, float angle) {
+    const XMVECTOR normal = XMVector3Normalize(axis);
+    const float    s      = std::sin(angle / 2.f);
+    return { normal.v[0] * s, normal.v[1] * s, normal.v[2] * s, std::cos(angle / 2.f) };
+}
+
+namespace Internal {
+/// Hamilton product a * b
+inline XMVECTOR quaternionProduct(FXMVECTOR a, FXMVECTOR b) {
+    return { a.v[3] * b.v[0] + a.v[0] * b.v[3] + a.v[1] * b.v[2] - a.v[2] * b.v[1],
+             a.v[3] * b.v[1] - a.v[0] * b.v[2] + a.v[1] * b.v[3] + a.v[2] * b.v[0],
+             a.v[3] * b.v[2] + a.v[0] * b.v[1] - a.v[1] * b.v[0] + a.v[2] * b.v[3],
+             a.v[3] * b.v[3] - a.v[0] * b.v[0] - a.v[1] * b.v[1] - a.v[2] * b.v[2] };
+}
+} // namespace Internal
+
+/// q * v * conjugate(q), w of the result is 0
+inline XMVECTOR XMVector3Rotate(FXMVECTOR v, FXMVECTOR q) {
+    const XMVECTOR pure      = { v.v[0], v.v[1], v.v[2], 0.f };
+    const XMVECTOR conjugate = { -q.v[0], -q.v[1], -q.v[2], q.v[3] };
+    XMVECTOR       result    = Internal::quaternionProduct(Internal::quaternionProduct(q, pure), conjugate);
+    result.v[3]              = 0.f;
+    return result;
+}
+
+namespace Internal {
+inline bool XMVector3IsUnit(FXMVECTOR a) {
+    return std::fabs(std::sqrt(a.v[0] * a.v[0] + a.v[1] * a.v[1] + a.v[2] * a.v[2]) - 1.f) <= 1e-4f;
+}
+} // namespace Internal
+
+} // namespace DirectX
+#endif
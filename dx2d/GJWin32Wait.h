@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+#include <windows.h>
+
+// Windows Waiter for FramePacer, see GJFramePacer.h
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002 //< Windows 10 1803 SDK
+#endif
+
+/// Sleeps on a high resolution waitable timer, which wakes within about half a millisecond instead of rounding up to the
+/// scheduler tick. Windows before 10 1803 have no such timer; there it falls back to Sleep, and its coarse slack makes
+/// FramePacer spin for longer.
+class HighResolutionTimerWaiter {
+public:
+    HighResolutionTimerWaiter()
+        : timer(CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS)) {}
+
+    ~HighResolutionTimerWaiter() {
+        if (timer) {
+            CloseHandle(timer);
+        }
+    }
+
+    HighResolutionTimerWaiter(HighResolutionTimerWaiter&& other) noexcept
+        : timer(std::exchange(other.timer, nullptr)) {}
+    HighResolutionTimerWaiter(const HighResolutionTimerWaiter&)            = delete;
+    HighResolutionTimerWaiter& operator=(const HighResolutionTimerWaiter&) = delete;
+
+    void sleepFor(std::chrono::nanoseconds duration) {
+        if (!timer) {
+            Sleep(DWORD(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count()));
+            return;
+        }
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -int64_t(duration.count() / 100); //< negative: relative, in 100 ns units
+        if (SetWaitableTimerEx(timer, &dueTime, 0, nullptr, nullptr, nullptr, 0)) {
+            WaitForSingleObject(timer, INFINITE);
+        }
+    }
+
+    std::chrono::nanoseconds getSlack() const {
+        return timer ? std::chrono::nanoseconds{ std::chrono::microseconds{ 500 } } : std::chrono::milliseconds{ 16 };
+    }
+
+private:
+    HANDLE timer;
+};
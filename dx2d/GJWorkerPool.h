@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for the renderer. Free of DirectX / Windows dependencies.
+
+/// Runs one job at a time on a fixed set of threads, which sleep between jobs. The calling thread takes part as thread
+/// 0, so a pool of 1 runs everything inline. Jobs are not copied and nothing is allocated per run.
+class WorkerPool {
+public:
+    /// \param threadCount including the calling thread. 0 is treated as 1
+    explicit WorkerPool(uint32_t threadCount) {
+        threadCount = std::max<uint32_t>(threadCount, 1);
+        workers.reserve(threadCount - 1);
+        for (uint32_t i = 1; i < threadCount; ++i) {
+            workers.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    ~WorkerPool() {
+        stopping = true;
+        generation.fetch_add(1);
+        generation.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&)            = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    uint32_t getThreadCount() const { return uint32_t(workers.size()) + 1; }
+
+    /// Calls job(threadIndex, threadCount) once on every thread and returns when all calls have returned. Threads may
+    /// wait for each other inside the job, e.g. with a std::barrier of getThreadCount().
+    template <typename Job>
+    void run(Job&& job) {
+        jobContext = &job;
+        jobFunction = [](void* context, uint32_t threadIndex, uint32_t threadCount) {
+            (*static_cast<Job*>(context))(threadIndex, threadCount);
+        };
+        remaining.store(uint32_t(workers.size()));
+        generation.fetch_add(1); //< publishes the job
+        generation.notify_all();
+
+        jobFunction(jobContext, 0, getThreadCount());
+
+        for (uint32_t left = remaining.load(); left != 0; left = remaining.load()) {
+            remaining.wait(left);
+        }
+    }
+
+private:
+    void workerLoop(uint32_t threadIndex) {
+        uint64_t seen = 0;
+        while (true) {
+            generation.wait(seen);
+            seen = generation.load();
+            if (stopping) {
+                return;
+            }
+            jobFunction(jobContext, threadIndex, getThreadCount());
+            if (remaining.fetch_sub(1) == 1) {
+                remaining.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::atomic<uint64_t>    generation = 0; //< bumped once per run
+    std::atomic<uint32_t>    remaining  = 0; //< workers still inside the current job
+    std::atomic<bool>        stopping   = false;
+    void*                    jobContext = nullptr;
+    void (*jobFunction)(void*, uint32_t, uint32_t) = nullptr;
+};
+
+/// A contiguous part of [0, count): rows of a band, columns of a strip.
+struct Share {
+    uint32_t begin = 0;
+    uint32_t end   = 0; //< exclusive
+};
+
+/// Hands out [0, count) in fixed-size chunks to whichever thread asks next, so threads that drew cheap chunks (sky rows,
+/// columns of plain walls) take on more of them. Reset it before WorkerPool::run, which publishes it to the threads.
+class ChunkQueue {
+public:
+    void reset(uint32_t _count, uint32_t _chunkSize) {
+        count     = _count;
+        chunkSize = std::max<uint32_t>(_chunkSize, 1);
+        cursor.store(0);
+    }
+
+    /// \return false once all of [0, count) has been handed out
+    bool next(Share& chunk) {
+        const uint32_t begin = cursor.fetch_add(chunkSize);
+        if (begin >= count) {
+            return false;
+        }
+        chunk = { begin, std::min(begin + chunkSize, count) };
+        return true;
+    }
+
+private:
+    std::atomic<uint32_t> cursor    = 0;
+    uint32_t              count     = 0;
+    uint32_t              chunkSize = 1;
+};
@@ -6,70 +6,43 @@
 #include <fstream>
 #include <numbers>
 #include <filesystem>
+#include <thread>
 
 #include <DirectXMath.h>
 
 #include "GJScene.h"
 #include "irrklang/irrKlang.h"
 #include "GJGlobals.h"
+#include "GJD2DBackend.h"
+#include "GJFramePacer.h"
 #include "GJRenderer.h"
+#include "GJTripleBuffer.h"
+#include "GJWin32Wait.h"
 
 using namespace DirectX;
 
-/// a.k.a the game engine. handles input, sound, and simulation. Delegates rendering.
+/// Frames per second the render thread is paced to whenever the present did not wait for vsync, e.g. while the window is
+/// minimized or covered. 0 never paces, so such frames spin a core
+constexpr double PRESENT_RATE = 60.;
+
+/// a.k.a the game engine. handles input, sound, and simulation. Delegates rendering to its render thread, which draws
+/// the snapshots the simulation publishes after every tick. Neither thread waits for the other.
 class GameEngine {
 public:
     GameEngine(HWND hWnd, const std::string& fileName)
-        : renderer{ hWnd, &gameplayState, &rendererScene } {
+        : hWnd(hWnd)
+        , renderer{ std::make_unique<D2DBackend>(hWnd) } {
         GGameTime = Seconds{ 0 };
         enterMAINMENU();
 
-        // loadMapFile:
-        [this, &fileName]() -> void {
-            // Load map into simulationScene, then advance rendererScene to simulationScene
-            gameplayState.fileName = fileName;
-            std::string       line;
-            std::stringstream ss;
-
-            namespace fs = std::filesystem;
-            fs::path p{ fileName };
+        // Load map into the simulation scene, then publish it for the render thread
+        loadMapFile(fileName, gameplayState, scene);
 
-            if (!fs::exists(p)) {
-                throw std::runtime_error("Cannot open map file '" + fileName + "': file does not exist");
-            }
-            if (!fs::is_regular_file(p)) {
-                throw std::runtime_error("Cannot open map file '" + fileName + "': not a regular file");
-            }
-
-            std::ifstream f;
-            f.open(fileName, std::ios::in | std::ios::binary);
-            if (!f.is_open()) {
-                int err = errno;
-                throw std::system_error(err, std::generic_category(), "Failed to open map file " + fileName);
-            }
-
-            gameplayState.width = gameplayState.height = 0;
-            while (f.peek() != EOF) {
-                ++gameplayState.height;
-                getline(f, line);
-                // remove any '\r' left by Windows line endings
-                if (!line.empty() && line.back() == '\r') {
-                    line.pop_back();
-                }
-
-                size_t findPlayer = line.find('@');
-                if (findPlayer != std::string::npos) {
-                    scene.camera.position =
-                        XMVECTOR{ static_cast<float>(findPlayer) + 0.5f, static_cast<float>(gameplayState.height) + 0.5f, 0, 0 };
-                    line[findPlayer] = ' ';
-                }
-                gameplayState.width = std::max(gameplayState.width, line.size());
-                ss << line;
-            }
-            gameplayState.map = ss.str();
-
-            advanceRendererToSimulation();
-        }();
+        // no motion to blend yet
+        poses[0].capture(scene);
+        poses[1]       = poses[0];
+        renderGameplay = gameplayState; //< the only copy of the map
+        publishSnapshot(Seconds{ 0 });
 
         // loadGameplay
         eventQueue = {
@@ -111,26 +84,48 @@ public:
             MessageBox(NULL, L"Could not play ingame.mp3", L"Error", MB_OK);
         }
         //}
+
+        renderThread = std::jthread([this](std::stop_token stop) { renderLoop(stop); });
     }
 
     void loadNewGame(const std::string& fileName) {
         // We can't use *this = {..} because that will create a temporary GameEngine and that is problematic:
         // The temporary's destructor will release resources whose handles will then be copied to *this. Goes both for:
         // 1. the winapi handles released via ComPtr
-        // 2. the pointers to Scene and GameplayState that both Simulation and Renderer hold internally.
+        // 2. the render thread, which reads this object's snapshots and renderer.
         // Finally, (Not a bug, but an inconvenience) if GameEngine has a large memory footprint, we might run out of memory when
         // the temporary gets created
 
-        HWND              hWndCopy     = renderer.hWnd;
+        HWND              hWndCopy     = hWnd;
         const std::string fileNameCopy = fileName;
         std::destroy_at(this);
         std::construct_at(this, hWndCopy, fileNameCopy);
     }
 
-    /// \param alpha [0..1] interpolation factor between simulation and renderer scenes
-    void draw(float alpha) {
-        interpolateRendererToSimulation(alpha);
-        renderer.draw();
+    /// Render thread. Draws the newest snapshot until stopped, blended between its two ticks by the time of the frame
+    void renderLoop(std::stop_token stop) {
+        FramePacer<HighResolutionTimerWaiter> pacer(PRESENT_RATE > 0. ? PRESENT_RATE : 1.);
+        while (!stop.stop_requested()) {
+            snapshots.update();
+            const SceneSnapshot& snapshot = snapshots.front();
+            ScenePose::blend(snapshot.previous, snapshot.current, snapshot.getAlpha(getTimePoint()), renderScene);
+            static_cast<GameplayStatus&>(renderGameplay) = snapshot.status;
+            renderer.draw(renderGameplay, renderScene);
+            if constexpr (PRESENT_RATE > 0.) {
+                if (!renderer.presentWaitedForVsync()) {
+                    pacer.wait();
+                }
+            }
+        }
+        if constexpr (PRESENT_RATE > 0.) {
+            printPacerStats("present", pacer.getStats());
+        }
+    }
+
+    /// Stops the render thread, which must not outlive the window or draw during static destruction, then exits
+    [[noreturn]] void quit() {
+        renderThread = {}; //< requests stop and joins
+        exit(0);
     }
 
     void kbHandlePREGAME(WPARAM wParam, bool keyDown) {
@@ -190,7 +185,7 @@ public:
             }
 
             else if (wParam == VK_BACK) {
-                exit(0);
+                quit();
             }
         }
     }
@@ -200,7 +195,7 @@ public:
             if (wParam == VK_RETURN) {
                 enterPREGAME();
             } else if (wParam == VK_BACK) {
-                exit(0);
+                quit();
             }
         }
     }
@@ -252,13 +247,15 @@ public:
         GEngineTime += delta;
         if (gameplayState.state == State::INGAME) {
             GGameTime += delta;
-            advanceRendererToSimulation();
-
             tickEvents(delta);
             tickStats(delta);
             tickMovement(delta);
             tickCollision(delta);
         }
+
+        currentPose ^= 1; //< the older pose becomes this tick's
+        poses[currentPose].capture(scene);
+        publishSnapshot(delta);
     }
 
     void tickEvents(Seconds UNUSED(delta)) {
@@ -448,11 +445,16 @@ public:
         }
     }
 
-    /// advance
-    void interpolateRendererToSimulation(float alpha) { rendererScene.interpolate(rendererScene, alpha); }
-
-    void advanceRendererToSimulation() {
-        rendererScene = scene; // full copy
+    /// Hands the two latest poses to the render thread, with what the HUD shows. Small and allocation free, unlike the
+    /// scene and map
+    void publishSnapshot(Seconds tickLength) {
+        SceneSnapshot& snapshot = snapshots.back();
+        snapshot.previous       = poses[currentPose ^ 1];
+        snapshot.current        = poses[currentPose];
+        snapshot.status         = gameplayState;
+        snapshot.tickTime       = getTimePoint();
+        snapshot.tickLength     = tickLength;
+        snapshots.publish();
     }
 
     void tickMovement(Seconds UNUSED(delta)) {
@@ -521,6 +523,7 @@ public:
         o2.momentum = XMVector3Normalize(away + (o2.momentum * o2.size));
     }
 
+    HWND       hWnd;
     GJRenderer renderer;
 
 private:
@@ -531,7 +534,13 @@ private:
 
     /// simulation scene
     GJScene scene{};
-    GJScene rendererScene{};
+
+    std::array<ScenePose, 2> poses;           //< of the two latest ticks, see tick
+    uint32_t                 currentPose = 0; //< into poses
+
+    // v * Render thread only, rebuilt from the newest snapshot every frame
+    GameplayState renderGameplay{};
+    GJScene       renderScene{};
 
     std::string                                             hiScoreFile      = "hiScore.txt";
     float                                                   globalSizeFactor = 0.f;
@@ -547,4 +556,7 @@ private:
     irrklang::ISoundEngine* audioEngine;
     using KeybindHandler = void (GameEngine::*)(WPARAM, bool);
     std::array<KeybindHandler, static_cast<size_t>(State::size)> kbCallTable;
+
+    TripleBuffer<SceneSnapshot> snapshots;
+    std::jthread                renderThread; //< last, so it is joined before anything it reads is destroyed
 };
@@ -25,6 +25,8 @@
 
 #include "GJGlobals.h"
 #include "GameEngine.h"
+#include "GJFramePacer.h"
+#include "GJWin32Wait.h"
 
 
 /// \return true if application should continue, false if application should stop
@@ -74,6 +76,9 @@ WCHAR     szWindowClass[MAX_LOADSTRING]; // the main window class name
 
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow) {
     enableConsole();
+    if constexpr (BENCH_RENDERER) {
+        std::atexit(cppBenchPrint); //< also covers exit(0) from the menus
+    }
 
     auto fileLogger = spdlog::basic_logger_mt("file_logger", "logs/output.log");
     spdlog::set_default_logger(fileLogger);
@@ -144,6 +149,9 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     const Seconds deltaTime{ 0.01 };
     const Seconds MAX_FRAMETIME{ 0.25 };
 
+    // Sleeps between ticks rather than spinning. Input is handled when the loop wakes, ticks only read it anyway
+    FramePacer<HighResolutionTimerWaiter> tickPacer(1. / deltaTime.count());
+
     // Game Loop based on https://gafferongames.com/post/fix_your_timestep/
     while (processPendingOsMessages()) {
         TimePoint newTime   = getTimePoint();
@@ -153,14 +161,16 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         currentTime = newTime;
         accumulator += frameTime;
 
+        // Frames are drawn by the engine's render thread, so a slow present no longer holds back ticks or input
         for (; accumulator >= deltaTime; accumulator -= deltaTime) {
             GGameEnginePtr->tick(deltaTime);
         }
-
-        const float alpha = toF(accumulator / deltaTime);
-        GGameEnginePtr->draw(alpha);
+        tickPacer.wait();
     }
+    printPacerStats("tick", tickPacer.getStats());
 
+    GGameEnginePtr = nullptr;
+    gameWorld.reset(); //< joins the render thread before COM goes away
     CoUninitialize();
     std::cout << "Press Enter to exit\n";
     std::cin.get();
@@ -178,7 +188,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         return 0;
     case WM_SIZE: {
         if (GGameEnginePtr) {
-            GGameEnginePtr->renderer.wmResize(hwnd);
+            GGameEnginePtr->renderer.requestResize();
         }
     }
         return 0;
@@ -0,0 +1,346 @@
+// bench.cpp : Benchmarks of the renderer's hot paths on a map, without a window. Prints its results.
+// Run from workingDir, which has the assets: bench [mapFile]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <string>
+#include <vector>
+
+#include "GJFramePacer.h"
+#include "GJRenderer.h"
+#include "GJSoftwareBackend.h"
+
+using Clock = std::chrono::steady_clock;
+
+/// Per-column reference for ColumnRayTable: the direction of column `x` of `width`, built from scratch with a
+/// quaternion rotation as the renderer did before the table.
+/// \return perspective correction coefficient
+float getPixelDir(const GJScene::Camera& camera, uint32_t width, uint32_t x, OUT XMVECTOR& dir) {
+    float imagePlaneDistance = camera.getImagePlaneDistance();                // depends on field of view
+    float pixelDirection     = (float(x) - float(width / 2)) / float(width); // -0.5 to 0.5 (because image plane has width 1)
+    dir                      = { imagePlaneDistance, pixelDirection, 0.f, 0.f };
+    dir                      = XMVector3Normalize(dir);
+    float screenSpaceAngle   = std::atan2(XMVectorGetY(dir), XMVectorGetX(dir));
+
+    float angle              = std::atan2(XMVectorGetY(camera.getDirectionVector()), XMVectorGetX(camera.getDirectionVector()));
+    XMVECTOR worldFromScreen = XMQuaternionRotationAxis(FXMVECTOR{ 0, 0, 1, 0 }, angle);
+    dir                      = XMVector3Rotate(dir, worldFromScreen);
+    assert(DirectX::Internal::XMVector3IsUnit(dir));
+
+    return std::abs(std::cos(screenSpaceAngle));
+}
+
+/// Prints how long a frame's column setup takes per column with getPixelDir and with ColumnRayTable, rebuilt every
+/// frame or only rotated, and how far apart their results are
+void benchColumnRays(const GJScene::Camera& camera, uint32_t width) {
+    constexpr int      ITERATIONS = 1000;
+    std::vector<float> dirX(width);
+    std::vector<float> dirY(width);
+    ColumnRayTable     table;
+    volatile float     sink = 0.f; //< keeps the reference alive
+
+    const auto run = [&](const char* name, auto&& setup) {
+        const auto start = Clock::now();
+        for (int i = 0; i < ITERATIONS; ++i) {
+            setup();
+        }
+        const double nsPerColumn =
+            std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ITERATIONS / double(width);
+        std::cout << fmt::format("column setup {} x{}: {:.2f} ns/column\n", name, width, nsPerColumn);
+    };
+    const XMVECTOR cameraDir = camera.getDirectionVector();
+    run("getPixelDir", [&]() {
+        XMVECTOR dir;
+        float    sum = 0.f;
+        for (uint32_t x = 0; x < width; ++x) {
+            sum += getPixelDir(camera, width, x, OUT dir) + XMVectorGetX(dir);
+        }
+        sink = sum;
+    });
+    run("ColumnRayTable rebuild", [&]() {
+        table.rebuild(camera.getImagePlaneDistance(), width);
+        table.rotate(XMVectorGetX(cameraDir), XMVectorGetY(cameraDir), dirX.data(), dirY.data());
+        sink = dirX[width / 2];
+    });
+    run("ColumnRayTable rotate", [&]() {
+        table.rotate(XMVectorGetX(cameraDir), XMVectorGetY(cameraDir), dirX.data(), dirY.data());
+        sink = dirX[width / 2];
+    });
+
+    float maxError = 0.f;
+    for (uint32_t x = 0; x < width; ++x) {
+        XMVECTOR    dir;
+        const float fixPersp = getPixelDir(camera, width, x, OUT dir);
+        maxError             = std::max({ maxError,
+                                          std::abs(XMVectorGetX(dir) - dirX[x]),
+                                          std::abs(XMVectorGetY(dir) - dirY[x]),
+                                          std::abs(fixPersp - table.fixPersp[x]) });
+    }
+    std::cout << fmt::format("column setup, largest difference to getPixelDir: {:.2e}\n", maxError);
+}
+
+/// Prints how long castColumnRays takes per column at every SimdLevel the CPU has, on the same columns: the camera's
+/// view turned through a full rotation at a few viewport widths
+void benchPacketRaycast(const SolidGridView& grid, const GJScene::Camera& camera) {
+    constexpr int   TURNS         = 64;
+    constexpr int   ITERATIONS    = 20;
+    constexpr float MAX_VIEW_DIST = 40.f; //< GJRenderer's MAXVIEWDIST
+    const float     originX       = XMVectorGetX(camera.position);
+    const float     originY       = XMVectorGetY(camera.position);
+    for (uint32_t width : { 360U, 960U }) {
+        ColumnRayTable     table;
+        std::vector<float> dirX(size_t(width) * TURNS);
+        std::vector<float> dirY(size_t(width) * TURNS);
+        table.rebuild(camera.getImagePlaneDistance(), width);
+        for (int turn = 0; turn < TURNS; ++turn) {
+            const float angle = camera.getDirectionAngle() + 2.f * std::numbers::pi_v<float> * float(turn) / float(TURNS);
+            table.rotate(std::cos(angle), std::sin(angle), dirX.data() + turn * width, dirY.data() + turn * width);
+        }
+
+        ColumnHits     hits;
+        double         scalarNs = 0.;
+        volatile float sink     = 0.f; //< keeps the trace alive
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 }) {
+            if (level > getSimdLevel()) {
+                continue;
+            }
+            const auto start = Clock::now();
+            for (int i = 0; i < ITERATIONS; ++i) {
+                for (int turn = 0; turn < TURNS; ++turn) {
+                    const size_t first = size_t(turn) * width;
+                    castColumnRays(grid, originX, originY, &dirX[first], &dirY[first], width, MAX_VIEW_DIST, hits, level);
+                    sink = sink + hits.distance[width / 2];
+                }
+            }
+            const double nsPerColumn =
+                std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ITERATIONS / TURNS / double(width);
+            scalarNs = level == SimdLevel::Scalar ? nsPerColumn : scalarNs;
+            std::cout << fmt::format("wall trace {} x{}: {:.2f} ns/column, {:.2f}x\n",
+                                     level == SimdLevel::AVX2    ? "AVX2"
+                                     : level == SimdLevel::SSE41 ? "SSE4.1"
+                                                                 : "scalar",
+                                     width,
+                                     nsPerColumn,
+                                     scalarNs / nsPerColumn);
+        }
+    }
+}
+
+/// Prints how long a full wall trace takes per frame in an open room, tracing every column and with WALL_LOD, turned
+/// through a full rotation from the room's middle
+void benchWallLod(const GJScene::Camera& camera) {
+    constexpr size_t         ROOM_SIZE = 48;
+    constexpr int            TURNS     = 64;
+    constexpr float          MAX_DIST  = 40.f; //< GJRenderer's MAXVIEWDIST
+    std::vector<std::string> rows(ROOM_SIZE, '#' + std::string(ROOM_SIZE - 2, ' ') + '#');
+    rows.front() = rows.back() = std::string(ROOM_SIZE, '#');
+    TileMap room;
+    room.compile(rows);
+    const SolidGridView grid   = room.getSolidGrid();
+    const float         middle = float(ROOM_SIZE) / 2.f + 0.5f;
+
+    for (uint32_t width : { 360U, 960U }) {
+        ColumnRayTable     table;
+        std::vector<float> dirX(width);
+        std::vector<float> dirY(width);
+        table.rebuild(camera.getImagePlaneDistance(), width);
+        double fullMs = 0.;
+        for (const ColumnLod& lod : { ColumnLod{}, WALL_LOD }) {
+            ColumnHitCache cache;
+            cache.setLod(lod);
+            size_t     traced = 0;
+            const auto start  = Clock::now();
+            for (int turn = 0; turn < TURNS; ++turn) {
+                const float angle = 2.f * std::numbers::pi_v<float> * float(turn) / float(TURNS);
+                table.rotate(std::cos(angle), std::sin(angle), dirX.data(), dirY.data());
+                cache.invalidate(); //< a full trace every frame, as when walking
+                traced += cache.update(grid,
+                                       { middle, middle, angle, table.imagePlaneDistance, width, MAX_DIST, grid.words },
+                                       table,
+                                       dirX.data(),
+                                       dirY.data());
+            }
+            const double msPerFrame = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / TURNS;
+            fullMs                  = lod.step <= 1 ? msPerFrame : fullMs;
+            std::cout << fmt::format("wall trace open room, step {} x{}: {:.3f} ms/frame, {:.2f}x, {:.0f}% of columns traced\n",
+                                     lod.step,
+                                     width,
+                                     msPerFrame,
+                                     fullMs / msPerFrame,
+                                     100. * double(traced) / double(TURNS) / double(width));
+        }
+    }
+}
+
+/// The floor of the debug view: black and white cells
+uint32_t sampleCheckerboard(float x, float y) {
+    const uint32_t c = (uint32_t(int64_t(std::floor(x)) + int64_t(std::floor(y))) % 2) * 255;
+    return 0xFF000000 | (c << 16) | (c << 8) | c;
+}
+
+/// Prints the throughput of the floor kernels at a few viewport sizes, looking along `view`
+/// \param vfov of the camera, radians
+void benchFloorKernels(const FloorView& view, float vfov, const CPUBitmap& floorTexture) {
+    for (uint32_t size : { 360U, 960U }) {
+        std::vector<uint32_t> pixels(size_t(size) * size);
+        const FrameView       frame     = { pixels.data(), size, size };
+        FloorView             sizedView = view;
+        sizedView.screenDist            = float(size) / 2.f / vfov;
+        sizedView.horizon               = int32_t(size / 2) - 1;
+
+        const size_t pixelCount = size_t(size) * size_t(size - uint32_t(getFloorBegin(frame, sizedView)));
+        const auto   run        = [&](const char* name, auto&& kernel) {
+            constexpr int ITERATIONS = 20;
+            const auto    start      = Clock::now();
+            for (int i = 0; i < ITERATIONS; ++i) {
+                kernel(frame, sizedView);
+            }
+            const auto   elapsed     = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+            const double pixelsPerNs = double(pixelCount) * ITERATIONS / double(elapsed.count());
+            std::cout << fmt::format("floor {} {}x{}: {:.3f} pixels/ns\n", name, size, size, pixelsPerNs);
+        };
+        run("reference", [](const FrameView& f, const FloorView& v) { castFloorReference(f, v, sampleCheckerboard); });
+        run("castFloor", [](const FrameView& f, const FloorView& v) { castFloor(f, v, sampleCheckerboard); });
+        run("textured scalar", [&](const FrameView& f, const FloorView& v) {
+            castFloorTextured(f, v, floorTexture, SimdLevel::Scalar);
+        });
+        run("textured", [&](const FrameView& f, const FloorView& v) { castFloorTextured(f, v, floorTexture); });
+    }
+}
+
+/// Prints how long shading a frame of walls takes per pixel at a few viewport sizes: flat, textured from level 0, and
+/// textured from the mip selectMip picks. Framed twice: facing a wall that fills the screen, and a far one a quarter of
+/// the screen high
+/// \param wallTexture column-major, with mips, as GJRenderer::loadWallTextures has it
+void benchWallShading(const CPUBitmap& wallTexture) {
+    constexpr int      ITERATIONS = 100;
+    constexpr uint32_t LIGHT      = 200; //< some fog, see GJRenderer::getWallLight
+    volatile uint32_t  sink       = 0;   //< keeps the frame alive
+    for (uint32_t size : { 360U, 960U }) {
+        std::vector<uint32_t> pixels(size_t(size) * size);
+        const FrameView       frame = { pixels.data(), size, size };
+        for (uint32_t spanHeight : { size, size / 4 }) {
+            const float top    = float(size - spanHeight) / 2.f;
+            const float bottom = top + float(spanHeight);
+            double      flatNs = 0.;
+            // the wall's tiles are square: each covers as many columns as rows
+            const auto run = [&](const std::string& name, size_t level, bool textured) {
+                const MipLevel mip   = wallTexture.getMip(level);
+                const auto     start = Clock::now();
+                for (int i = 0; i < ITERATIONS; ++i) {
+                    for (uint32_t x = 0; x < size; ++x) {
+                        if (textured) {
+                            const size_t    u         = size_t(x % spanHeight) * mip.width / spanHeight;
+                            const uint32_t* texColumn = wallTexture.column(u, level);
+                            drawTexturedColumnSpan(frame, x, top, bottom, texColumn, uint32_t(mip.height), LIGHT);
+                        } else {
+                            fillColumnSpan(frame, x, top, bottom, 0xFF808080);
+                        }
+                    }
+                    sink = sink + pixels[size_t(size / 2) * size + uint32_t(i) % size];
+                }
+                const double nsPerPixel =
+                    std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ITERATIONS / size / spanHeight;
+                flatNs = textured ? flatNs : nsPerPixel;
+                std::cout << fmt::format("wall shading {}x{}, walls {} high, {}: {:.3f} ns/pixel, {:.2f}x flat\n",
+                                         size,
+                                         size,
+                                         spanHeight,
+                                         name,
+                                         nsPerPixel,
+                                         nsPerPixel / flatNs);
+            };
+            const size_t level = wallTexture.selectMip(float(wallTexture.height) / float(spanHeight));
+            run("flat", 0, false);
+            run("textured level 0", 0, true);
+            run(fmt::format("mipped level {}", level), level, true);
+        }
+    }
+}
+
+/// Prints how long drawScenePasses takes on the renderer's current frame with 1 to 16 threads, then restores the
+/// configured pool
+void benchThreadScaling(GJRenderer& renderer, uint32_t viewportWidth, uint32_t viewportHeight) {
+    constexpr int ITERATIONS = 100;
+    double        oneThread  = 0.;
+    for (uint32_t threads : { 1U, 2U, 4U, 8U, 16U }) {
+        renderer.setRenderThreadCount(threads);
+        renderer.drawScenePasses(); //< warm up the threads and caches
+        const auto start = Clock::now();
+        for (int i = 0; i < ITERATIONS; ++i) {
+            renderer.drawScenePasses();
+        }
+        const double msPerFrame = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / ITERATIONS;
+        oneThread               = threads == 1 ? msPerFrame : oneThread;
+        std::cout << fmt::format("scene passes {}x{}, {:>2} threads: {:.3f} ms/frame, {:.2f}x\n",
+                                 viewportWidth,
+                                 viewportHeight,
+                                 threads,
+                                 msPerFrame,
+                                 oneThread / msPerFrame);
+    }
+    renderer.setRenderThreadCount(GJRenderer::getConfiguredRenderThreads());
+}
+
+/// Paces a second of frames with FramePacer<ThreadSleepWaiter> at a few rates, each frame busy for a third of its
+/// period as if drawing, and prints the rate reached and the pacer's stats
+void benchFramePacer() {
+    for (double rate : { 60., 144. }) {
+        FramePacer<ThreadSleepWaiter> pacer(rate);
+        const auto                    work  = pacer.getPeriod() / 3;
+        const int                     count = int(rate);
+        const auto                    start = Clock::now();
+        for (int frame = 0; frame < count; ++frame) {
+            const auto frameStart = Clock::now();
+            while (Clock::now() - frameStart < work) {
+            }
+            pacer.wait();
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << fmt::format("frame pacer at {:.0f} Hz: {:.2f} frames/s\n", rate, double(count) / seconds);
+        printPacerStats(fmt::format("{:.0f} Hz", rate).c_str(), pacer.getStats());
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::string mapFile = argc > 1 ? argv[1] : "assets/map1.txt";
+    spdlog::set_level(spdlog::level::warn);
+
+    try {
+        GameplayState state;
+        GJScene       scene;
+        loadMapFile(mapFile, state, scene);
+        state.state = State::INGAME;
+
+        constexpr uint32_t SIZE         = 360; //< the low res target of a 720 pixel high window, see D2DBackend
+        auto               backend      = std::make_unique<SoftwareBackend>(SIZE, SIZE);
+        CPUBitmap          floorTexture = backend->decodeImage(L"assets/textures/4.png"); //< the renderer's floor
+        CPUBitmap          wallTexture  = backend->decodeImage(L"assets/textures/1.png");
+        floorTexture.generateMips();
+        wallTexture.setLayout(TexelLayout::ColumnMajor);
+        wallTexture.generateMips();
+
+        GJRenderer renderer(std::move(backend));
+        renderer.setFrame(state, scene);
+        renderer.setSceneScale(1.f);
+        renderer.traceWalls();
+
+        benchColumnRays(scene.camera, SIZE);
+        benchPacketRaycast(state.tiles.getSolidGrid(), scene.camera);
+        benchWallLod(scene.camera);
+        benchFloorKernels(renderer.getFloorView(), scene.camera.getVfov(), floorTexture);
+        benchWallShading(wallTexture);
+        benchThreadScaling(renderer, SIZE, SIZE);
+        benchFramePacer();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
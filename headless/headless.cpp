@@ -0,0 +1,45 @@
+// headless.cpp : Renders frames of a map without a window, through SoftwareBackend, and writes them as PPM files.
+// Run from workingDir, which has the assets: headless [frames] [outputDir] [mapFile]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <string>
+
+#include "GJRenderer.h"
+#include "GJSoftwareBackend.h"
+
+int main(int argc, char** argv) {
+    const int                   frames    = argc > 1 ? std::stoi(argv[1]) : 8;
+    const std::filesystem::path outputDir = argc > 2 ? argv[2] : "frames";
+    const std::string           mapFile   = argc > 3 ? argv[3] : "assets/map1.txt";
+    spdlog::set_level(spdlog::level::warn); //< the camera logs every turn
+
+    try {
+        GameplayState state;
+        GJScene       scene;
+        loadMapFile(mapFile, state, scene);
+        state.state = State::INGAME;
+
+        // the low res target of a 720 pixel high window, see D2DBackend
+        auto             backend = std::make_unique<SoftwareBackend>(360, 360);
+        SoftwareBackend& output  = *backend;
+        GJRenderer       renderer(std::move(backend));
+
+        // one turn on the spot, over all frames
+        std::filesystem::create_directories(outputDir);
+        const float startAngle = scene.camera.getDirectionAngle();
+        for (int i = 0; i < frames; ++i) {
+            scene.camera.setDirectionAngle(startAngle + 2.f * std::numbers::pi_v<float> * float(i) / float(frames));
+            renderer.draw(state, scene);
+            writePPM(output.getFrame(), outputDir / fmt::format("frame{:03}.ppm", i));
+        }
+        std::cout << "wrote " << frames << " frames to " << outputDir.string() << '\n';
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+// GJColumnHitCacheTest.cpp : ColumnHitCache reusing the previous frame's trace while the camera stands still or turns
+// sees what a full trace with castColumnRays sees.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GJRaycastPacket.h"
+#include "GJTest.h"
+
+namespace {
+
+constexpr uint32_t  WIDTH          = 360;
+constexpr float     MAX_DIST       = 40.f;
+constexpr float     PLANE_DISTANCE = 0.6f;              //< about 80 degrees of field of view
+constexpr ColumnLod WALL_LOD       = { 4, 6.f, 0.25f }; //< GJRenderer's
+
+/// A walled map with random pillars, and an empty cell to stand in
+std::vector<std::string> makeRows(std::mt19937& rng, size_t width, size_t height, float wallShare) {
+    std::bernoulli_distribution isWall(wallShare);
+    std::vector<std::string>    rows(height, std::string(width, '#'));
+    for (size_t y = 1; y + 1 < height; ++y) {
+        for (size_t x = 1; x + 1 < width; ++x) {
+            rows[y][x] = isWall(rng) ? '#' : ' ';
+        }
+    }
+    rows[height / 2][width / 2] = ' ';
+    return rows;
+}
+
+/// One frame's camera and columns, as GJRenderer::traceWalls has them
+struct View {
+    View(const SolidGridView& grid, float originX, float originY) : grid(grid), originX(originX), originY(originY) {
+        rays.rebuild(PLANE_DISTANCE, WIDTH);
+        dirX.resize(WIDTH);
+        dirY.resize(WIDTH);
+    }
+
+    ColumnTraceKey turnTo(float _angle) {
+        angle = _angle;
+        rays.rotate(std::cos(angle), std::sin(angle), dirX.data(), dirY.data());
+        return { originX, originY, angle, PLANE_DISTANCE, WIDTH, MAX_DIST, grid.words };
+    }
+
+    SolidGridView      grid;
+    float              originX;
+    float              originY;
+    float              angle = 0.f;
+    ColumnRayTable     rays;
+    std::vector<float> dirX;
+    std::vector<float> dirY;
+};
+
+/// How far a cache's hits are from a full trace's
+struct Differences {
+    size_t columns    = 0;
+    size_t otherFace  = 0;   //< hit another side or face line, or hit where the full trace missed
+    size_t outOfBound = 0;   //< on the same face line, but further off than a ray half a column off could be
+    float  maxAlong   = 0.f; //< largest distance along the face between the two hit points
+
+    /// \param dirX, dirY of the full trace's columns
+    /// \param halfColumn largest angle between a column and the ray it reuses, radians
+    void add(const ColumnHits& cached, const ColumnHits& full, const float* dirX, const float* dirY, float halfColumn) {
+        for (size_t x = 0; x < full.size(); ++x) {
+            ++columns;
+            const bool eastWest  = full.side[x] == RayHit::EAST_WEST;
+            const bool otherLine = eastWest ? cached.cellX[x] != full.cellX[x] : cached.cellY[x] != full.cellY[x];
+            if (cached.side[x] != full.side[x] || otherLine) {
+                ++otherFace;
+                continue;
+            }
+            if (full.side[x] == RayHit::NULLSIDE) {
+                continue;
+            }
+            // Positions along the face line: a hit on a tile edge may be on either tile, with texU 0 or almost 1. The hit
+            // point moves along the face by the distance times the angle, over the cosine of the incidence
+            const auto getAlong = [eastWest, x](const ColumnHits& h) {
+                return float(eastWest ? h.cellY[x] : h.cellX[x]) + h.texU[x];
+            };
+            const float distance  = full.distance[x];
+            const float incidence = eastWest ? std::abs(dirX[x]) : std::abs(dirY[x]);
+            const float bound     = 1.01f * distance * std::tan(halfColumn) / incidence + 1e-5f * (1.f + distance); //< + rounding
+            const float along     = std::abs(getAlong(cached) - getAlong(full));
+            maxAlong              = std::max(maxAlong, along);
+            outOfBound += along > bound || std::abs(cached.distance[x] - full.distance[x]) > bound;
+        }
+    }
+};
+
+ColumnHits traceFull(const View& view) {
+    ColumnHits hits;
+    castColumnRays(view.grid, view.originX, view.originY, view.dirX.data(), view.dirY.data(), WIDTH, MAX_DIST, hits);
+    return hits;
+}
+
+bool equal(const ColumnHits& a, const ColumnHits& b) {
+    return a.distance == b.distance && a.texU == b.texU && a.side == b.side && a.cellX == b.cellX && a.cellY == b.cellY;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(5);
+    TileMap      tiles;
+
+    // a camera standing still traces once, and its hits are the full trace's
+    {
+        tiles.compile(makeRows(rng, 30, 30, 0.15f));
+        View           view(tiles.getSolidGrid(), 15.5f, 15.5f);
+        ColumnHitCache cache;
+        const auto     key = view.turnTo(0.3f);
+        CHECK(cache.update(view.grid, key, view.rays, view.dirX.data(), view.dirY.data()) == WIDTH, "first frame");
+        CHECK(cache.update(view.grid, key, view.rays, view.dirX.data(), view.dirY.data()) == 0, "standing still");
+        CHECK(equal(cache.getHits(), traceFull(view)), "standing still: hits differ from a full trace");
+    }
+
+    // turning by up to a few columns a frame: every column sees the face the full trace sees, unless an occluder slips
+    // between two rays. Distances and texU are off by what a ray up to half a column off sees
+    Differences                           turns;
+    size_t                                traced = 0;
+    const float                           column = 1.f / PLANE_DISTANCE / float(WIDTH); //< the widest angle between two columns
+    std::uniform_real_distribution<float> turn(-3.f * column, 3.f * column);
+    std::uniform_real_distribution<float> angle(0.f, 2.f * std::numbers::pi_v<float>);
+    for (int map = 0; map < 10; ++map) {
+        tiles.compile(makeRows(rng, 40, 40, 0.1f));
+        View           view(tiles.getSolidGrid(), 20.5f, 20.5f);
+        ColumnHitCache cache;
+        float          a = angle(rng);
+        cache.update(view.grid, view.turnTo(a), view.rays, view.dirX.data(), view.dirY.data());
+        for (int frame = 0; frame < 200; ++frame) {
+            a += frame % 10 == 0 ? 0.01f * column : turn(rng); //< now and then by a fraction of a column
+            traced += cache.update(view.grid, view.turnTo(a), view.rays, view.dirX.data(), view.dirY.data());
+            turns.add(cache.getHits(), traceFull(view), view.dirX.data(), view.dirY.data(), 0.5f * column);
+        }
+    }
+    std::cout << "turning: " << traced << " of " << turns.columns << " columns traced, " << turns.otherFace
+              << " on another face, largest difference along a face " << turns.maxAlong << '\n';
+    CHECK(traced < turns.columns / 2, "turning traced " << traced << " of " << turns.columns << " columns");
+    CHECK(turns.otherFace <= turns.columns / 10000, turns.otherFace << " of " << turns.columns << " columns on another face");
+    CHECK(turns.outOfBound == 0, turns.outOfBound << " of " << turns.columns << " columns further off than half a column");
+
+    // level of detail over random views, from open rooms to crowded ones: interpolated columns see what a full trace sees,
+    // up to rounding
+    {
+        Differences                           lod;
+        size_t                                traced = 0;
+        std::uniform_real_distribution<float> position(1.f, 63.f);
+        for (int map = 0; map < 20; ++map) {
+            tiles.compile(makeRows(rng, 64, 64, map % 2 ? 0.01f : 0.05f));
+            const SolidGridView grid = tiles.getSolidGrid();
+            ColumnHitCache      cache;
+            cache.setLod(WALL_LOD);
+            for (int v = 0; v < 25; ++v) {
+                View view(grid, position(rng), position(rng));
+                traced += cache.update(grid, view.turnTo(angle(rng)), view.rays, view.dirX.data(), view.dirY.data());
+                lod.add(cache.getHits(), traceFull(view), view.dirX.data(), view.dirY.data(), 0.f);
+            }
+        }
+        std::cout << "level of detail: " << traced << " of " << lod.columns << " columns traced, largest difference along a face "
+                  << lod.maxAlong << '\n';
+        CHECK(traced < lod.columns * 3 / 4, "level of detail traced " << traced << " of " << lod.columns << " columns");
+        CHECK(lod.otherFace == 0, lod.otherFace << " of " << lod.columns << " columns on another face");
+        CHECK(lod.outOfBound == 0, lod.outOfBound << " of " << lod.columns << " columns further off than rounding");
+    }
+
+    return testResult();
+}
@@ -0,0 +1,133 @@
+// GJFloorTest.cpp : the AVX2 floor row samplers write exactly what sampleFloorRowScalar writes, and castFloor sees the
+// floor castFloorReference sees, up to the pixels rounding puts on the other side of a cell edge.
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <vector>
+
+#include "GJFloor.h"
+#include "GJTest.h"
+
+namespace {
+
+constexpr uint32_t TEXTURE_SIZE        = 64;
+constexpr float    FOV                 = 1.f;   //< the camera's default, about 57 degrees
+constexpr float    MAX_CELLS_PER_PIXEL = 0.25f; //< of the rows compared with the reference
+
+/// The floor of the debug view: black and white cells
+uint32_t sampleCheckerboard(float x, float y) {
+    const uint32_t c = (uint32_t(int64_t(std::floor(x)) + int64_t(std::floor(y))) % 2) * 255;
+    return 0xFF000000 | (c << 16) | (c << 8) | c;
+}
+
+/// Rows like castFloorTextured's: world positions anywhere on a map, steps of up to a few texels per pixel
+std::vector<FloorRow> makeRows(std::mt19937& rng, size_t count) {
+    std::uniform_real_distribution<float> position(-64.f, 64.f);
+    std::uniform_real_distribution<float> step(-0.1f, 0.1f);
+    std::vector<FloorRow>                 rows(count);
+    for (FloorRow& r : rows) {
+        r = { position(rng), position(rng), step(rng), step(rng), 1.f };
+    }
+    return rows;
+}
+
+/// Samples every row at every width with `simdLevel` and with the scalar path, counting the pixels that differ
+template <typename Texel>
+void checkAgainstScalar(const BasicFloorTexture<Texel>& tex, const std::vector<FloorRow>& rows, const char* name) {
+    // tails of 0 to 7 pixels past the last full 8
+    constexpr uint32_t WIDTHS[] = { 1, 7, 8, 9, 15, 16, 17, 63, 64, 65, 360, 361, 366, 959, 960 };
+    size_t             pixels   = 0;
+    size_t             differ   = 0;
+    for (uint32_t width : WIDTHS) {
+        std::vector<Texel> simd(width);
+        std::vector<Texel> scalar(width);
+        for (const FloorRow& r : rows) {
+            const uint32_t done = sampleFloorRowAVX2(simd.data(), width, r, tex);
+            CHECK(done == width / 8 * 8, name << ": " << done << " of " << width << " pixels sampled");
+            sampleFloorRowScalar(simd.data(), done, width, r, tex);
+            sampleFloorRowScalar(scalar.data(), 0, width, r, tex);
+            for (uint32_t i = 0; i < width; ++i) {
+                differ += simd[i] != scalar[i];
+            }
+            pixels += width;
+        }
+    }
+    CHECK(differ == 0, name << ": " << differ << " of " << pixels << " pixels differ from the scalar path");
+}
+
+/// Casts the floor of random views of a size x size viewport with castFloor and castFloorReference
+/// \return pixels that differ, of `pixels` floor pixels
+size_t compareWithReference(std::mt19937& rng, uint32_t size, size_t& pixels) {
+    std::uniform_real_distribution<float> position(0.f, 64.f); //< on a map
+    std::uniform_real_distribution<float> angle(0.f, 2.f * std::numbers::pi_v<float>);
+    std::uniform_real_distribution<float> height(0.2f, 0.8f);
+    std::uniform_int_distribution<int>    pitch(-int(size) / 4, int(size) / 4);
+    std::vector<uint32_t>                 fast(size_t(size) * size);
+    std::vector<uint32_t>                 reference(size_t(size) * size);
+    const FrameView                       fastFrame      = { fast.data(), size, size };
+    const FrameView                       referenceFrame = { reference.data(), size, size };
+    size_t                                differ         = 0;
+    for (int v = 0; v < 10; ++v) {
+        const FloorView view = { position(rng),
+                                 position(rng),
+                                 angle(rng),
+                                 height(rng),
+                                 float(size) / 2.f / FOV,
+                                 std::tan(FOV / 2.f),
+                                 int32_t(size / 2) - 1 + pitch(rng) };
+        castFloor(fastFrame, view, sampleCheckerboard);
+        castFloorReference(referenceFrame, view, sampleCheckerboard);
+        for (int32_t y = getFloorBegin(fastFrame, view); y < int32_t(size); ++y) {
+            // rows toward the horizon step over several cells a pixel: any rounding there picks another cell
+            const float step = 2.f * view.horTan * view.camHeight * getRowScale(view, y - view.horizon - 1) / float(size);
+            if (step > MAX_CELLS_PER_PIXEL) {
+                continue;
+            }
+            for (uint32_t x = 0; x < size; ++x) {
+                differ += fastFrame.row(uint32_t(y))[x] != referenceFrame.row(uint32_t(y))[x];
+            }
+            pixels += size;
+        }
+    }
+    return differ;
+}
+
+} // namespace
+
+int main() {
+    // castFloor against castFloorReference: the two compute the same points along different paths, the pixels whose
+    // centers lie within rounding of a cell edge may fall on either side. At most 1 in 500 of them
+    {
+        std::mt19937 rng(11);
+        for (uint32_t size : { 360U, 960U }) {
+            size_t       pixels = 0;
+            const size_t differ = compareWithReference(rng, size, pixels);
+            std::cout << size << "x" << size << ": " << differ << " of " << pixels << " floor pixels differ from the reference\n";
+            CHECK(differ * 500 <= pixels, size << "x" << size << ": " << differ << " of " << pixels << " floor pixels differ");
+        }
+    }
+
+#if GJ_SIMD_X86
+    if (getSimdLevel() == SimdLevel::AVX2) {
+        std::mt19937 rng(42);
+        // every BGRA texel different and neighboring indices too, so a wrong texel index shows
+        std::vector<uint32_t> texels(TEXTURE_SIZE * TEXTURE_SIZE);
+        std::vector<uint8_t>  indices(TEXTURE_SIZE * TEXTURE_SIZE + 3); //< padded, see Palette::quantize
+        for (uint32_t i = 0; i < TEXTURE_SIZE * TEXTURE_SIZE; ++i) {
+            texels[i]  = i;
+            indices[i] = uint8_t(i * 37 + (i >> 8));
+        }
+        const std::vector<FloorRow> rows = makeRows(rng, 3000);
+        constexpr uint32_t          MASK = TEXTURE_SIZE - 1;
+        checkAgainstScalar(FloorTexture{ texels.data(), TEXTURE_SIZE, MASK, MASK }, rows, "BGRA");
+        checkAgainstScalar(IndexedFloorTexture{ indices.data(), TEXTURE_SIZE, MASK, MASK }, rows, "indexed");
+    } else {
+        std::cout << "no AVX2, the floor kernels are not compared\n";
+    }
+#endif
+
+    return testResult();
+}
@@ -0,0 +1,96 @@
+// GJInterlaceTest.cpp : reconstructColumns with reconstructPixelsSSE41 writes exactly what reconstructPixelsScalar
+// writes, for either parity of the missing columns and for widths leaving tails of every length.
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "GJInterlace.h"
+#include "GJTest.h"
+
+namespace {
+
+constexpr uint32_t HEIGHT = 6;
+
+/// A frame whose missing columns are garbage, a history and the columns it is read from, -1 for some
+struct Case {
+    Case(std::mt19937& rng, uint32_t width, uint32_t parity)
+        : pixels(size_t(width) * HEIGHT)
+        , historyPixels(size_t(width) * HEIGHT)
+        , historyColumns(width, -1)
+        , width(width)
+        , drawn{ parity, 2 } {
+        std::uniform_int_distribution<uint32_t> texel;
+        std::uniform_int_distribution<int32_t>  column(-1, int32_t(width) - 1);
+        for (uint32_t& p : pixels) {
+            p = texel(rng);
+        }
+        for (uint32_t& p : historyPixels) {
+            p = texel(rng);
+        }
+        for (uint32_t x = 1 - parity; x < width; x += 2) {
+            historyColumns[x] = column(rng) / 2 * 2 + int32_t(parity); //< the previous frame's drawn columns, or -1
+        }
+    }
+
+    FrameView getFrame() { return { pixels.data(), width, HEIGHT }; }
+
+    Reprojection getReprojection(int32_t rowShift) const {
+        return { { const_cast<uint32_t*>(historyPixels.data()), width, HEIGHT }, historyColumns.data(), rowShift };
+    }
+
+    std::vector<uint32_t> pixels;
+    std::vector<uint32_t> historyPixels;
+    std::vector<int32_t>  historyColumns;
+    uint32_t              width;
+    ColumnSet             drawn;
+};
+
+} // namespace
+
+int main() {
+#if GJ_SIMD_X86
+    if (getSimdLevel() >= SimdLevel::SSE41) {
+        std::mt19937 rng(3);
+        // 8 pixels, 4 of them missing, per SSE4.1 iteration: tails of 0 to 7 columns, and frames narrower than one
+        std::vector<uint32_t> widths;
+        for (uint32_t width = 2; width <= 40; ++width) {
+            widths.push_back(width);
+        }
+        widths.insert(widths.end(), { 359, 360, 361, 362, 363, 364, 365, 366, 367 });
+
+        size_t pixels = 0;
+        for (uint32_t width : widths) {
+            for (uint32_t parity : { 0U, 1U }) {
+                // history rows in place, shifted, and shifted partly or wholly out of the frame
+                for (int32_t rowShift : { 0, 1, -2, 4, int32_t(HEIGHT), -int32_t(HEIGHT) - 1 }) {
+                    const Case         original(rng, width, parity);
+                    const Reprojection reprojection = original.getReprojection(rowShift);
+                    Case               scalar       = original;
+                    Case               simd         = original;
+                    reconstructColumns(scalar.getFrame(), original.drawn, reprojection, ALL_ROWS, SimdLevel::Scalar);
+                    reconstructColumns(simd.getFrame(), original.drawn, reprojection, ALL_ROWS, SimdLevel::SSE41);
+
+                    size_t differ = 0;
+                    size_t drawn  = 0; //< changed drawn pixels
+                    for (size_t i = 0; i < scalar.pixels.size(); ++i) {
+                        differ += simd.pixels[i] != scalar.pixels[i];
+                        drawn += i % width % 2 == parity && simd.pixels[i] != original.pixels[i];
+                    }
+                    CHECK(differ == 0,
+                          "width " << width << ", parity " << parity << ", row shift " << rowShift << ": " << differ
+                                   << " pixels differ from the scalar path");
+                    CHECK(drawn == 0, "width " << width << ", parity " << parity << ": " << drawn << " drawn pixels changed");
+                    pixels += scalar.pixels.size();
+                }
+            }
+        }
+        std::cout << pixels << " pixels compared\n";
+    } else {
+        std::cout << "no SSE4.1, the reconstruction kernels are not compared\n";
+    }
+#endif
+
+    return testResult();
+}
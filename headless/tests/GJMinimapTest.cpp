@@ -0,0 +1,155 @@
+// GJMinimapTest.cpp : MinimapImage synced after tile edits, and uploaded row by row as GJRenderer::syncMinimap does,
+// matches a minimap built from scratch.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GJMinimap.h"
+#include "GJSoftwareBackend.h"
+#include "GJTest.h"
+
+namespace {
+
+/// What GJRenderer::syncMinimap does with an update
+void upload(SoftwareBackend& backend, const MinimapImage& minimap, const MinimapUpdate& update) {
+    if (update.resized) {
+        backend.createImage(EGPUBitmap::Minimap, uint32_t(minimap.getWidth()), uint32_t(minimap.getHeight()));
+    }
+    if (update.dirtyTop < update.dirtyEnd) {
+        backend.updateImage(EGPUBitmap::Minimap, minimap.getTexels(), update.dirtyTop, update.dirtyEnd);
+    }
+}
+
+/// The minimap image as `backend` draws it, one pixel per tile
+std::vector<uint32_t> drawn(SoftwareBackend& backend, const MinimapImage& minimap) {
+    backend.beginFrame();
+    backend.drawImage(EGPUBitmap::Minimap, { 0.f, 0.f, float(minimap.getWidth()), float(minimap.getHeight()) });
+    const FrameView       frame = backend.getLowResFrame();
+    std::vector<uint32_t> pixels;
+    for (uint32_t y = 0; y < minimap.getHeight(); ++y) {
+        pixels.insert(pixels.end(), frame.row(y), frame.row(y) + minimap.getWidth());
+    }
+    return pixels;
+}
+
+std::vector<uint32_t> texels(const MinimapImage& minimap) {
+    return { minimap.getTexels(), minimap.getTexels() + minimap.getWidth() * minimap.getHeight() };
+}
+
+std::vector<std::string> makeRows(std::mt19937& rng, size_t width, size_t height) {
+    std::bernoulli_distribution isWall(0.3);
+    std::vector<std::string>    rows(height, std::string(width, ' '));
+    for (std::string& row : rows) {
+        for (char& tile : row) {
+            tile = isWall(rng) ? '#' : ' ';
+        }
+    }
+    return rows;
+}
+
+/// Checks `minimap`, kept in sync since the start and uploaded to `backend` row by row, against one built from scratch
+void checkAgainstRebuild(const TileMap& tiles, float alpha, const MinimapImage& minimap, SoftwareBackend& backend, int step) {
+    MinimapImage        rebuilt;
+    const MinimapUpdate update = rebuilt.sync(tiles.getSolidGrid(), alpha);
+    SoftwareBackend     rebuiltBackend(128, 64);
+    upload(rebuiltBackend, rebuilt, update);
+
+    CHECK(texels(minimap) == texels(rebuilt), "texels differ at step " << step);
+    CHECK(drawn(backend, minimap) == drawn(rebuiltBackend, rebuilt), "uploaded image differs at step " << step);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937             rng(7);
+    std::vector<std::string> rows = makeRows(rng, 100, 30); //< two solid words per row
+    TileMap                  tiles;
+    tiles.compile(rows);
+
+    constexpr float ALPHA = 0.7f;
+    MinimapImage    minimap;
+    SoftwareBackend backend(128, 64);
+    MinimapUpdate   update = minimap.sync(tiles.getSolidGrid(), ALPHA);
+    CHECK(update.resized && update.dirtyTop == 0 && update.dirtyEnd == 30, "first sync draws everything");
+    upload(backend, minimap, update);
+    checkAgainstRebuild(tiles, ALPHA, minimap, backend, 0);
+
+    // edit a few tiles at a time: only their rows are redrawn and uploaded
+    std::uniform_int_distribution<size_t> edits(0, 3);
+    std::uniform_int_distribution<size_t> column(0, 99);
+    std::uniform_int_distribution<size_t> row(0, 29);
+    for (int step = 1; step <= 200; ++step) {
+        uint32_t editedTop = 30;
+        uint32_t editedEnd = 0;
+        for (size_t i = edits(rng); i > 0; --i) {
+            const size_t x = column(rng);
+            const size_t y = row(rng);
+            rows[y][x]     = rows[y][x] == '#' ? ' ' : '#';
+            editedTop      = std::min(editedTop, uint32_t(y));
+            editedEnd      = std::max(editedEnd, uint32_t(y) + 1);
+        }
+        tiles.compile(rows);
+
+        update = minimap.sync(tiles.getSolidGrid(), ALPHA);
+        upload(backend, minimap, update);
+        CHECK(!update.resized, "resized at step " << step);
+        if (editedTop < editedEnd) {
+            // a tile flipped twice leaves its row unchanged, so the dirty rows may be fewer than the edited ones
+            CHECK(update.dirtyTop >= editedTop && update.dirtyEnd <= editedEnd, "dirty rows at step " << step);
+        } else {
+            CHECK(update.dirtyTop >= update.dirtyEnd, "rows redrawn without an edit at step " << step);
+        }
+        checkAgainstRebuild(tiles, ALPHA, minimap, backend, step);
+    }
+
+    // an unchanged map, or a copy of it, returns without comparing a word: a grid with the same version but other words
+    // is not redrawn
+    {
+        const TileMap copy = tiles;
+        CHECK(copy.getVersion() == tiles.getVersion(), "a copy has another version");
+        SolidGridView         grid = copy.getSolidGrid();
+        std::vector<uint64_t> words(grid.words, grid.words + grid.wordsPerRow * grid.height);
+        words[0] ^= 1;
+        grid.words = words.data();
+        update     = minimap.sync(grid, ALPHA);
+        CHECK(!update.resized && update.dirtyTop >= update.dirtyEnd, "unchanged version redrawn");
+
+        // the same tiles compiled again are a new version, compared word by word
+        tiles.compile(rows);
+        CHECK(tiles.getVersion() != copy.getVersion(), "compile kept the version");
+        update = minimap.sync(tiles.getSolidGrid(), ALPHA);
+        CHECK(update.dirtyTop >= update.dirtyEnd, "rows redrawn after compiling the same tiles");
+        checkAgainstRebuild(tiles, ALPHA, minimap, backend, 200);
+
+        // as is a grid not from a TileMap
+        grid         = tiles.getSolidGrid();
+        grid.version = 0;
+        words.assign(grid.words, grid.words + grid.wordsPerRow * grid.height);
+        words[0] ^= 1;
+        grid.words = words.data();
+        update     = minimap.sync(grid, ALPHA);
+        CHECK(update.dirtyTop == 0 && update.dirtyEnd == 1, "grid without a version: first row not redrawn");
+        update = minimap.sync(tiles.getSolidGrid(), ALPHA);
+        upload(backend, minimap, update);
+        checkAgainstRebuild(tiles, ALPHA, minimap, backend, 200);
+    }
+
+    // another size, or another alpha, is drawn anew
+    rows = makeRows(rng, 70, 20);
+    tiles.compile(rows);
+    update = minimap.sync(tiles.getSolidGrid(), ALPHA);
+    CHECK(update.resized && update.dirtyTop == 0 && update.dirtyEnd == 20, "resize draws everything");
+    upload(backend, minimap, update);
+    checkAgainstRebuild(tiles, ALPHA, minimap, backend, 201);
+
+    update = minimap.sync(tiles.getSolidGrid(), 0.5f);
+    CHECK(!update.resized && update.dirtyTop == 0 && update.dirtyEnd == 20, "new alpha draws everything");
+    upload(backend, minimap, update);
+    checkAgainstRebuild(tiles, 0.5f, minimap, backend, 202);
+
+    return testResult();
+}
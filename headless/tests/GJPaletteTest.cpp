@@ -0,0 +1,80 @@
+// GJPaletteTest.cpp : the unshaded colormap leaves every palette index as it is, and each darker light level maps every
+// index to a color no brighter than the level above it does.
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "GJPalette.h"
+#include "GJTest.h"
+
+namespace {
+
+/// Opaque texels: random colors of a few hues, each in a ramp from dark to bright, like a wall texture's
+CPUBitmap makeTexture(std::mt19937& rng, size_t size) {
+    std::uniform_int_distribution<uint32_t> channel(0, 255);
+    std::uniform_int_distribution<uint32_t> hue(0, 3);
+
+    const auto     random  = [&] { return 0xFF000000 | channel(rng) << 16 | channel(rng) << 8 | channel(rng); };
+    const uint32_t hues[4] = { 0xFFFFFFFF, random(), random() & 0xFFFFFF00, random() & 0xFF0000FF };
+    CPUBitmap      texture = { .width = size, .height = size, .channels = 4 };
+    texture.data.resize(size * size * 4);
+    uint32_t* texels = reinterpret_cast<uint32_t*>(texture.data.data());
+    for (size_t i = 0; i < size * size; ++i) {
+        texels[i] = shadeBGRA(hues[hue(rng)], channel(rng) + 1);
+    }
+    return texture;
+}
+
+/// Integer luma, Rec. 601 weights
+uint32_t getLuma(uint32_t color) {
+    return 299 * ((color >> 16) & 0xFF) + 587 * ((color >> 8) & 0xFF) + 114 * (color & 0xFF);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(16);
+    for (int build = 0; build < 5; ++build) {
+        std::vector<CPUBitmap> textures;
+        for (int t = 0; t < 2 + build * 3; ++t) {
+            textures.push_back(makeTexture(rng, 64));
+        }
+        std::vector<const CPUBitmap*> pointers;
+        for (const CPUBitmap& texture : textures) {
+            pointers.push_back(&texture);
+        }
+        const uint32_t extraColors[] = { 0xFF3050A0, 0xFF707070 }; //< e.g. the floor and ceiling colors
+        Palette        palette;
+        palette.build(pointers, extraColors);
+        const auto& colors = palette.getColors();
+
+        // full light: every index, TRANSPARENT_INDEX and the unused ones included, stays itself
+        const uint8_t* unshaded = palette.getColormap(LIGHT_LEVELS);
+        size_t         moved    = 0;
+        for (uint32_t i = 0; i < 256; ++i) {
+            moved += unshaded[i] != i;
+        }
+        CHECK(moved == 0, "build " << build << ": the unshaded colormap moves " << moved << " indices");
+
+        // darker levels: never a brighter color than the level above
+        size_t brighter = 0;
+        for (uint32_t level = 0; level < LIGHT_LEVELS; ++level) {
+            const uint8_t* map   = palette.getColormap(level);
+            const uint8_t* above = palette.getColormap(level + 1);
+            for (uint32_t i = 0; i < 256; ++i) {
+                brighter += getLuma(colors[map[i]]) > getLuma(colors[above[i]]);
+            }
+        }
+        CHECK(brighter == 0, "build " << build << ": " << brighter << " indices brighter than at the light level above");
+
+        // no light: everything that is drawn is the darkest color, like shadeBGRA(color, 0)
+        const uint8_t* dark = palette.getColormap(0);
+        for (uint32_t i = 1; i < 256; ++i) {
+            CHECK(dark[i] == palette.nearest(0xFF000000), "build " << build << ": index " << i << " at light level 0");
+        }
+        CHECK(dark[TRANSPARENT_INDEX] == TRANSPARENT_INDEX, "build " << build << ": transparent at light level 0");
+    }
+    return testResult();
+}
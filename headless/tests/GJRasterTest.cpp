@@ -0,0 +1,217 @@
+// GJRasterTest.cpp : the column span fillers clip to the frame, touch only their own column, and step the texture v
+// so that every row reads the texel under its pixel center, up to the span's ends.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "GJRaster.h"
+#include "GJTest.h"
+
+namespace {
+
+constexpr uint32_t WIDTH      = 4;
+constexpr uint32_t HEIGHT     = 100;
+constexpr uint32_t X          = 2;
+constexpr uint32_t BACKGROUND = 0xFF123456;
+constexpr uint32_t COLOR      = 0xFF808080;
+constexpr float    INF        = std::numeric_limits<float>::infinity();
+constexpr float    NOT_A_SPAN = std::numeric_limits<float>::quiet_NaN(); //< e.g. a wall at distance 0: inf - inf
+
+struct Frame {
+    explicit Frame(uint32_t height = HEIGHT) : pixels(size_t(WIDTH) * height, BACKGROUND), view{ pixels.data(), WIDTH, height } {}
+
+    /// \return rows [begin, end) of column X hold `inside`, every other pixel of the frame is untouched
+    bool only(int32_t begin, int32_t end, uint32_t inside) const {
+        for (uint32_t y = 0; y < view.height; ++y) {
+            for (uint32_t x = 0; x < WIDTH; ++x) {
+                const bool     in       = x == X && int32_t(y) >= begin && int32_t(y) < end;
+                const uint32_t expected = in ? inside : BACKGROUND;
+                if (view.row(y)[x] != expected) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    std::vector<uint32_t> pixels;
+    FrameView             view;
+};
+
+/// Texel i of the column is 0xFF000000 | i, which a light of 256 draws unchanged
+std::vector<uint32_t> makeTexColumn(uint32_t texHeight) {
+    std::vector<uint32_t> texels(texHeight);
+    for (uint32_t i = 0; i < texHeight; ++i) {
+        texels[i] = 0xFF000000 | i;
+    }
+    return texels;
+}
+
+/// Texel v under the center of row y of a span [yTop, yBottom) stretched over texHeight texels
+double getV(int32_t y, float yTop, float yBottom, uint32_t texHeight) {
+    return (double(y) + 0.5 - double(yTop)) * double(texHeight) / (double(yBottom) - double(yTop));
+}
+
+uint32_t texelAt(int32_t y, float yTop, float yBottom, uint32_t texHeight) {
+    return std::min(uint32_t(std::floor(getV(y, yTop, yBottom, texHeight))), texHeight - 1);
+}
+
+/// `texel` is texelAt(y), or, where a pixel center lies on a texel edge within the rounding of the 16.16 v steps from the
+/// span's first drawn row `begin`, the texel on the edge's other side
+bool isTexelAt(uint32_t texel, int32_t y, int32_t begin, float yTop, float yBottom, uint32_t texHeight) {
+    const double v     = getV(y, yTop, yBottom, texHeight);
+    const double edge  = std::round(v);
+    const double slack = double(y - begin + 1) / 65536. + 1e-6 * double(texHeight); //< + float rounding
+    if (texel == texelAt(y, yTop, yBottom, texHeight)) {
+        return true;
+    }
+    return std::abs(v - edge) <= slack && edge > 0. && texel == std::min(uint32_t(edge) - (v >= edge), texHeight - 1);
+}
+
+/// Draws the span and checks every drawn row's texel against texelAt, and that nothing else was touched
+void checkTextured(float yTop, float yBottom, uint32_t texHeight) {
+    const std::vector<uint32_t> texels = makeTexColumn(texHeight);
+    Frame                       frame;
+    drawTexturedColumnSpan(frame.view, X, yTop, yBottom, texels.data(), texHeight, 256);
+
+    const SpanRows rows  = clipSpan(frame.view, yTop, yBottom);
+    size_t         wrong = 0;
+    int32_t        first = rows.end; //< first row reading the wrong texel
+    for (int32_t y = rows.begin; y < rows.end; ++y) {
+        if (!isTexelAt(frame.view.row(uint32_t(y))[X] & 0xFFFFFF, y, rows.begin, yTop, yBottom, texHeight)) {
+            first = std::min(first, y);
+            ++wrong;
+        }
+    }
+    CHECK(wrong == 0,
+          "span [" << yTop << ", " << yBottom << ") over " << texHeight << " texels: " << wrong << " rows of [" << rows.begin
+                   << ", " << rows.end << ") read the wrong texel, the first row " << first << " reads "
+                   << (wrong ? frame.view.row(uint32_t(first))[X] & 0xFFFFFF : 0) << ", not "
+                   << texelAt(first, yTop, yBottom, texHeight));
+    for (int32_t y = 0; y < int32_t(HEIGHT); ++y) {
+        for (uint32_t x = 0; x < WIDTH; ++x) {
+            const bool drawn = x == X && y >= rows.begin && y < rows.end;
+            CHECK(drawn || frame.view.row(uint32_t(y))[x] == BACKGROUND,
+                  "span [" << yTop << ", " << yBottom << "): pixel " << x << ", " << y << " touched");
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    // clipSpan: the rows whose pixel centers lie in the span, within the frame
+    {
+        const FrameView frame = { nullptr, WIDTH, HEIGHT };
+        const auto      rows  = [&](float yTop, float yBottom) {
+            const SpanRows r = clipSpan(frame, yTop, yBottom);
+            return r.begin < r.end ? std::vector<int32_t>{ r.begin, r.end } : std::vector<int32_t>{};
+        };
+        using Rows = std::vector<int32_t>;
+        CHECK(rows(10.f, 20.f) == (Rows{ 10, 20 }), "inside");
+        CHECK(rows(10.4f, 20.6f) == (Rows{ 10, 21 }), "pixel centers inside");
+        CHECK(rows(10.6f, 20.4f) == (Rows{ 11, 20 }), "pixel centers outside");
+        CHECK(rows(10.5f, 20.5f) == (Rows{ 10, 20 }), "on pixel centers: half open");
+        CHECK(rows(-50.f, 20.f) == (Rows{ 0, 20 }), "partly above");
+        CHECK(rows(90.f, 150.f) == (Rows{ 90, 100 }), "partly below");
+        CHECK(rows(-50.f, 150.f) == (Rows{ 0, 100 }), "over the whole column");
+        CHECK(rows(-INF, INF) == (Rows{ 0, 100 }), "infinite");
+        CHECK(rows(-50.f, -10.f).empty(), "fully above");
+        CHECK(rows(-50.f, 0.5f).empty(), "above, ending on the first pixel center");
+        CHECK(rows(110.f, 150.f).empty(), "fully below");
+        CHECK(rows(99.6f, 150.f).empty(), "below, starting past the last pixel center");
+        CHECK(rows(INF, INF).empty(), "infinitely far below");
+        CHECK(rows(30.f, 30.f).empty(), "zero height");
+        CHECK(rows(30.2f, 30.4f).empty(), "no pixel center");
+        CHECK(rows(40.f, 30.f).empty(), "upside down");
+        CHECK(rows(NOT_A_SPAN, INF).empty() && rows(-INF, NOT_A_SPAN).empty(), "not a number");
+    }
+
+    // fillColumnSpan and blendColumnSpan write the clipped rows of their column only
+    {
+        const uint32_t blended = blendBGRA(BACKGROUND, COLOR, 128);
+        const auto     check   = [&](float yTop, float yBottom, int32_t begin, int32_t end, const char* what) {
+            Frame fill;
+            fillColumnSpan(fill.view, X, yTop, yBottom, COLOR);
+            CHECK(fill.only(begin, end, COLOR), "fillColumnSpan, " << what);
+            Frame blend;
+            blendColumnSpan(blend.view, X, yTop, yBottom, COLOR, 128);
+            CHECK(blend.only(begin, end, blended), "blendColumnSpan, " << what);
+        };
+        check(10.f, 20.f, 10, 20, "inside");
+        check(-50.f, 20.f, 0, 20, "partly above");
+        check(90.f, 150.f, 90, 100, "partly below");
+        check(-INF, INF, 0, 100, "infinite");
+        check(-50.f, -10.f, 0, 0, "fully above");
+        check(110.f, 150.f, 0, 0, "fully below");
+        check(30.f, 30.f, 0, 0, "zero height");
+        check(40.f, 30.f, 0, 0, "upside down");
+        check(NOT_A_SPAN, INF, 0, 0, "not a number");
+
+        Frame outside;
+        fillColumnSpan(outside.view, WIDTH, 10.f, 20.f, COLOR);
+        blendColumnSpan(outside.view, WIDTH, 10.f, 20.f, COLOR, 128);
+        CHECK(outside.only(0, 0, 0), "a column right of the frame");
+    }
+
+    // drawTexturedColumnSpan: every row reads the texel under its pixel center, the first and last included
+    {
+        checkTextured(0.f, 64.f, 64);     //< one texel per row
+        checkTextured(0.f, 100.f, 64);    //< magnified
+        checkTextured(20.f, 27.f, 64);    //< minified
+        checkTextured(10.3f, 83.7f, 256); //< the span's ends between pixel centers
+        checkTextured(40.f, 40.9f, 64);   //< one row
+        checkTextured(40.4f, 40.6f, 256); //< thinner than a texel step: one row
+        checkTextured(30.f, 30.f, 64);    //< zero height
+        checkTextured(-300.f, 60.f, 64);  //< clipped above: starts inside the texture
+        checkTextured(50.f, 900.f, 64);   //< clipped below
+        checkTextured(-5000.f, 5000.f, 256);
+        checkTextured(-50.f, -10.f, 64);  //< fully above
+        checkTextured(110.f, 150.f, 64);  //< fully below
+        checkTextured(NOT_A_SPAN, INF, 64);
+    }
+
+    // an infinite span, of a wall at distance ~0, reads its texture's first texel all the way
+    {
+        const std::vector<uint32_t> texels = makeTexColumn(64);
+        Frame                       frame;
+        drawTexturedColumnSpan(frame.view, X, -INF, INF, texels.data(), 64, 256);
+        CHECK(frame.only(0, HEIGHT, texels[0]), "infinite span");
+    }
+
+    // clipping does not shift the texture: a partly visible span reads what the same span in a taller frame reads
+    {
+        const std::vector<uint32_t> texels = makeTexColumn(128);
+        Frame                       clipped;
+        Frame                       tall(3 * HEIGHT);
+        drawTexturedColumnSpan(clipped.view, X, -123.4f, 156.7f, texels.data(), 128, 256);
+        drawTexturedColumnSpan(tall.view, X, -123.4f + float(HEIGHT), 156.7f + float(HEIGHT), texels.data(), 128, 256);
+        bool same = true;
+        for (uint32_t y = 0; y < HEIGHT; ++y) {
+            same &= clipped.view.row(y)[X] == tall.view.row(y + HEIGHT)[X];
+        }
+        CHECK(same, "clipped span reads other texels than the whole span");
+    }
+
+    // drawIndexedColumnSpan steps v like drawTexturedColumnSpan
+    {
+        std::vector<uint8_t> indices(200);
+        std::iota(indices.begin(), indices.end(), uint8_t(0));
+        std::vector<uint8_t> colormap(256);
+        std::iota(colormap.begin(), colormap.end(), uint8_t(0));
+        std::vector<uint8_t>   pixels(size_t(WIDTH) * HEIGHT, 255);
+        const IndexedFrameView frame = { pixels.data(), WIDTH, HEIGHT };
+        drawIndexedColumnSpan(frame, X, -37.3f, 81.9f, indices.data(), 200, colormap.data());
+        size_t wrong = 0;
+        for (uint32_t y = 0; y < HEIGHT; ++y) {
+            wrong += y < 82 ? !isTexelAt(frame.row(y)[X], int32_t(y), 0, -37.3f, 81.9f, 200) : frame.row(y)[X] != 255;
+        }
+        CHECK(wrong == 0, "indexed: " << wrong << " rows differ");
+    }
+
+    return testResult();
+}
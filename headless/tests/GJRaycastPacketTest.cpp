@@ -0,0 +1,132 @@
+// GJRaycastPacketTest.cpp : castColumnRays at every SimdLevel the CPU has writes exactly what castColumnRaysScalar writes.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GJRaycastPacket.h"
+#include "GJTest.h"
+
+namespace {
+
+std::vector<std::string> makeRows(std::mt19937& rng, size_t width, size_t height, float wallShare) {
+    std::bernoulli_distribution isWall(wallShare);
+    std::vector<std::string>    rows(height, std::string(width, ' '));
+    for (std::string& row : rows) {
+        for (char& tile : row) {
+            tile = isWall(rng) ? '#' : ' ';
+        }
+    }
+    return rows;
+}
+
+const char* getName(SimdLevel level) {
+    return level == SimdLevel::AVX2 ? "AVX2" : level == SimdLevel::SSE41 ? "SSE4.1" : "scalar";
+}
+
+struct Counts {
+    size_t hits   = 0;
+    size_t misses = 0;
+};
+
+/// Traces `count` columns at every SimdLevel up to the CPU's and compares each column with castColumnRaysScalar
+void checkAgainstScalar(const SolidGridView&      grid,
+                        float                     originX,
+                        float                     originY,
+                        const std::vector<float>& dirX,
+                        const std::vector<float>& dirY,
+                        size_t                    count,
+                        float                     maxDist,
+                        Counts&                   counts) {
+    ColumnHits scalar;
+    scalar.resize(count);
+    castColumnRaysScalar(grid, originX, originY, dirX.data(), dirY.data(), 0, count, maxDist, scalar);
+    for (size_t i = 0; i < count; ++i) {
+        ++(scalar.side[i] == RayHit::NULLSIDE ? counts.misses : counts.hits);
+    }
+
+    for (SimdLevel level : { SimdLevel::SSE41, SimdLevel::AVX2 }) {
+        if (level > getSimdLevel()) {
+            continue;
+        }
+        ColumnHits packet;
+        castColumnRays(grid, originX, originY, dirX.data(), dirY.data(), count, maxDist, packet, level);
+        size_t differ = 0;
+        size_t first  = count;
+        for (size_t i = 0; i < count; ++i) {
+            const RayHit a = packet.get(i);
+            const RayHit b = scalar.get(i);
+            if (a.distance != b.distance || a.texU != b.texU || a.side != b.side || a.cellX != b.cellX || a.cellY != b.cellY) {
+                first = std::min(first, i);
+                ++differ;
+            }
+        }
+        if (differ) {
+            const RayHit a = packet.get(first);
+            const RayHit b = scalar.get(first);
+            CHECK(false,
+                  getName(level) << ": " << differ << " of " << count << " columns differ from (" << originX << ", "
+                                 << originY << "), maxDist " << maxDist << ". Column " << first << ": distance "
+                                 << a.distance << " vs " << b.distance << ", texU " << a.texU << " vs " << b.texU
+                                 << ", side " << int(a.side) << " vs " << int(b.side) << ", cell " << a.cellX << "," << a.cellY
+                                 << " vs " << b.cellX << "," << b.cellY);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(99);
+
+    // odd counts leave tails of every length to the scalar path
+    constexpr size_t COUNTS[] = { 1, 3, 4, 5, 7, 8, 9, 13, 17, 31, 33, 360, 361, 367 };
+
+    Counts                                counts;
+    TileMap                               tiles;
+    std::uniform_real_distribution<float> position(-6.f, 46.f); //< also outside the map, looking into it or away
+    std::uniform_real_distribution<float> angle(0.f, 2.f * std::numbers::pi_v<float>);
+    std::uniform_real_distribution<float> maxDist(0.f, 30.f);  //< cut off short of the walls, too
+    for (int map = 0; map < 10; ++map) {
+        tiles.compile(makeRows(rng, 40 + size_t(map) * 11, 32, map % 2 ? 0.05f : 0.2f)); //< 1 or 2 solid words per row
+        const SolidGridView grid = tiles.getSolidGrid();
+        for (int view = 0; view < 20; ++view) {
+            for (size_t count : COUNTS) {
+                // a fan of columns like a frame's, plus random directions
+                std::vector<float> dirX(count);
+                std::vector<float> dirY(count);
+                const float        start = angle(rng);
+                for (size_t i = 0; i < count; ++i) {
+                    const float a = view % 2 ? angle(rng) : start + float(i) / float(count);
+                    dirX[i]       = std::cos(a);
+                    dirY[i]       = std::sin(a);
+                }
+                checkAgainstScalar(grid, position(rng), position(rng), dirX, dirY, count, maxDist(rng), counts);
+            }
+        }
+    }
+    CHECK(counts.hits > 1000 && counts.misses > 1000, counts.hits << " hits and " << counts.misses << " misses");
+
+    // axis aligned, (0, 0) and from the cell corners: rays that never cross one axis' boundaries
+    {
+        tiles.compile(makeRows(rng, 70, 20, 0.3f));
+        const SolidGridView grid = tiles.getSolidGrid();
+        std::vector<float>  dirX = { 1.f, -1.f, 0.f, 0.f, 0.f, -0.f, 1.f, 0.f, -1.f };
+        std::vector<float>  dirY = { 0.f, 0.f, 1.f, -1.f, 0.f, 0.f, -0.f, -0.f, 1.f };
+        for (float y = -1.f; y <= 21.f; y += 0.5f) {
+            for (float x = -1.f; x <= 71.f; x += 0.5f) {
+                checkAgainstScalar(grid, x, y, dirX, dirY, dirX.size(), 25.f, counts);
+            }
+        }
+    }
+
+    if (getSimdLevel() == SimdLevel::Scalar) {
+        std::cout << "no SSE4.1, the packet kernels are not compared\n";
+    }
+    return testResult();
+}
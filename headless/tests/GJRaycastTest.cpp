@@ -0,0 +1,224 @@
+// GJRaycastTest.cpp : traverseRay / castRay against a brute-force intersection of the ray with every solid cell's box.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GJRaycast.h"
+#include "GJTest.h"
+
+namespace {
+
+constexpr float INF = std::numeric_limits<float>::infinity();
+
+struct Grid {
+    int64_t              width  = 0;
+    int64_t              height = 0;
+    std::vector<uint8_t> solid;
+
+    bool isSolid(size_t x, size_t y) const { return solid[y * size_t(width) + x] != 0; }
+};
+
+/// Distances along the ray at which it is inside [low, high] on one axis. A ray parallel to the axis is inside for all
+/// of them or for none
+void slab(float origin, float dir, float low, float high, float& enter, float& exit) {
+    if (dir == 0.f) {
+        const bool inside = origin >= low && origin <= high;
+        enter             = inside ? -INF : INF;
+        exit              = inside ? INF : -INF;
+        return;
+    }
+    const float t0 = (low - origin) / dir;
+    const float t1 = (high - origin) / dir;
+    enter          = std::min(t0, t1);
+    exit           = std::max(t0, t1);
+}
+
+/// Where the ray enters the box of cell (x, y), or INF if it misses it, only touches its edge or corner, or enters it
+/// behind the origin
+float enterCell(float originX, float originY, float dirX, float dirY, int64_t x, int64_t y, RayHit::Side* side = nullptr) {
+    float enterX, exitX, enterY, exitY;
+    slab(originX, dirX, float(x), float(x + 1), enterX, exitX);
+    slab(originY, dirY, float(y), float(y + 1), enterY, exitY);
+    const float enter = std::max(enterX, enterY);
+    if (enter >= std::min(exitX, exitY) || enter < 0.f) {
+        return INF;
+    }
+    if (side) {
+        *side = enterX > enterY ? RayHit::EAST_WEST : RayHit::NORTH_SOUTH;
+    }
+    return enter;
+}
+
+/// The nearest solid cell whose box the ray enters within maxDist. The origin's cell is skipped, as in traverseRay
+RayHit bruteForce(const Grid& grid, float originX, float originY, float dirX, float dirY, float maxDist) {
+    const int64_t originCellX = int64_t(std::floor(originX));
+    const int64_t originCellY = int64_t(std::floor(originY));
+    RayHit        nearest;
+    nearest.distance = maxDist;
+    for (int64_t y = 0; y < grid.height; ++y) {
+        for (int64_t x = 0; x < grid.width; ++x) {
+            if (!grid.isSolid(size_t(x), size_t(y)) || (x == originCellX && y == originCellY)) {
+                continue;
+            }
+            RayHit::Side side  = RayHit::NULLSIDE;
+            const float  enter = enterCell(originX, originY, dirX, dirY, x, y, &side);
+            if (enter <= maxDist && (nearest.side == RayHit::NULLSIDE || enter < nearest.distance)) {
+                nearest.distance = enter;
+                nearest.side     = side;
+                nearest.cellX    = int32_t(x);
+                nearest.cellY    = int32_t(y);
+            }
+        }
+    }
+    return nearest;
+}
+
+RayHit cast(const Grid& grid, float originX, float originY, float dirX, float dirY, float maxDist) {
+    return castRay(originX, originY, dirX, dirY, maxDist, grid.width, grid.height, [&grid](size_t x, size_t y) {
+        return grid.isSolid(x, y);
+    });
+}
+
+bool near(float a, float b) { return std::abs(a - b) <= 1e-4f * (1.f + std::abs(b)); }
+
+/// castRay agrees with bruteForce. Where the ray passes a cell corner within rounding, both cells sharing it are right
+void checkAgainstBruteForce(const Grid& grid, float originX, float originY, float dirX, float dirY, float maxDist) {
+    const RayHit dda   = cast(grid, originX, originY, dirX, dirY, maxDist);
+    const RayHit brute = bruteForce(grid, originX, originY, dirX, dirY, maxDist);
+    const auto   where = [&]() {
+        return "origin (" + std::to_string(originX) + ", " + std::to_string(originY) + "), direction (" + std::to_string(dirX) +
+               ", " + std::to_string(dirY) + "), maxDist " + std::to_string(maxDist);
+    };
+
+    if (brute.side == RayHit::NULLSIDE || dda.side == RayHit::NULLSIDE) {
+        // either may see a hit right at maxDist that the other rounds past it
+        const bool atCutOff = near(brute.distance, maxDist) && near(dda.distance, maxDist);
+        CHECK(dda.side == brute.side || atCutOff, where() << ": hit " << dda.side << " vs " << brute.side);
+        CHECK(near(dda.distance, brute.distance), where() << ": distance " << dda.distance << " vs " << brute.distance);
+        return;
+    }
+
+    CHECK(near(dda.distance, brute.distance), where() << ": distance " << dda.distance << " vs " << brute.distance);
+    if (dda.cellX != brute.cellX || dda.cellY != brute.cellY) {
+        const float ddaCellEnter = enterCell(originX, originY, dirX, dirY, dda.cellX, dda.cellY);
+        CHECK(near(ddaCellEnter, brute.distance),
+              where() << ": cell " << dda.cellX << "," << dda.cellY << " vs " << brute.cellX << "," << brute.cellY);
+        return;
+    }
+    CHECK(dda.side == brute.side || std::abs(dirX) == std::abs(dirY), where() << ": side " << dda.side << " vs " << brute.side);
+
+    const float along = dda.side == RayHit::EAST_WEST ? originY + dda.distance * dirY : originX + dda.distance * dirX;
+    const float texU  = along - std::floor(along);
+    CHECK(near(dda.texU, texU) || std::abs(dda.texU - texU) > 0.999f, where() << ": texU " << dda.texU << " vs " << texU);
+}
+
+Grid makeRandomGrid(std::mt19937& rng, int64_t width, int64_t height, float solidShare) {
+    std::bernoulli_distribution isSolid(solidShare);
+    Grid                        grid = { width, height, std::vector<uint8_t>(size_t(width * height)) };
+    for (uint8_t& cell : grid.solid) {
+        cell = isSolid(rng);
+    }
+    return grid;
+}
+
+/// A map from rows of characters, solid where they have a '#'
+Grid makeGrid(const std::vector<const char*>& rows) {
+    Grid grid = { int64_t(std::strlen(rows[0])), int64_t(rows.size()), {} };
+    for (const char* row : rows) {
+        for (const char* c = row; *c; ++c) {
+            grid.solid.push_back(*c == '#');
+        }
+    }
+    return grid;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(1234);
+
+    // random rays through random maps, from inside and outside the map, cut off at random distances
+    {
+        std::uniform_real_distribution<float> position(-8.f, 28.f);
+        std::uniform_real_distribution<float> angle(0.f, 2.f * 3.14159265f);
+        std::uniform_real_distribution<float> maxDist(0.f, 40.f);
+        for (int map = 0; map < 20; ++map) {
+            const Grid grid = makeRandomGrid(rng, 20, 16, 0.2f);
+            for (int ray = 0; ray < 500; ++ray) {
+                const float a = angle(rng);
+                checkAgainstBruteForce(grid, position(rng), position(rng), std::cos(a), std::sin(a), maxDist(rng));
+            }
+        }
+    }
+
+    // axis aligned rays, and ones at 45 degrees, from every cell of a random map
+    {
+        const Grid                                grid       = makeRandomGrid(rng, 12, 10, 0.3f);
+        constexpr float                           DIAGONAL   = 0.70710678f;
+        const std::array<std::array<float, 2>, 8> directions = { { { 1.f, 0.f },
+                                                                   { -1.f, 0.f },
+                                                                   { 0.f, 1.f },
+                                                                   { 0.f, -1.f },
+                                                                   { DIAGONAL, DIAGONAL },
+                                                                   { -DIAGONAL, DIAGONAL },
+                                                                   { DIAGONAL, -DIAGONAL },
+                                                                   { -DIAGONAL, -DIAGONAL } } };
+        // off the cell corners: at 45 degrees, through a corner both cells sharing it are right
+        for (float y = -1.55f; y < 11.f; y += 1.f) {
+            for (float x = -1.3f; x < 13.f; x += 1.f) {
+                for (const auto& [dirX, dirY] : directions) {
+                    checkAgainstBruteForce(grid, x, y, dirX, dirY, 20.f);
+                }
+            }
+        }
+    }
+
+    const Grid room = makeGrid({
+        "#######",
+        "#.....#",
+        "#.#.#.#",
+        "#.....#",
+        "#######",
+    });
+
+    // outside the map: cells out of bounds are empty, so the ray reaches the map and hits its border
+    {
+        const RayHit hit = cast(room, -5.5f, 1.5f, 1.f, 0.f, 40.f);
+        CHECK(hit.side == RayHit::EAST_WEST && hit.cellX == 0 && hit.cellY == 1, "entering from the west");
+        CHECK(near(hit.distance, 5.5f), "entering from the west at " << hit.distance);
+        CHECK(cast(room, -5.5f, 1.5f, -1.f, 0.f, 40.f).side == RayHit::NULLSIDE, "leaving the map to the west");
+    }
+
+    // a (0, 0) direction crosses no cell boundary, so it hits nothing
+    {
+        const RayHit hit = cast(room, 1.5f, 1.5f, 0.f, 0.f, 40.f);
+        CHECK(hit.side == RayHit::NULLSIDE && hit.distance == 40.f, "(0, 0) direction");
+    }
+
+    // maxDist: a hit exactly at maxDist counts, one just behind it does not
+    {
+        CHECK(cast(room, 1.5f, 1.5f, 1.f, 0.f, 4.5f).cellX == 6, "hit at maxDist");
+        const RayHit miss = cast(room, 1.5f, 1.5f, 1.f, 0.f, 4.4f);
+        CHECK(miss.side == RayHit::NULLSIDE && miss.distance == 4.4f, "hit behind maxDist");
+        CHECK(cast(room, 1.5f, 1.5f, 1.f, 0.f, 0.f).side == RayHit::NULLSIDE, "maxDist 0");
+    }
+
+    // Inside a solid cell, the origin's own cell is not hit: traverseRay only tests the cells the ray enters, so a camera
+    // clipping into a wall sees out of it, up to the next wall. A box intersection would report the origin's cell at
+    // distance 0 and draw the whole view as that one wall.
+    {
+        const RayHit hit = cast(room, 2.5f, 2.5f, 1.f, 0.f, 40.f);
+        CHECK(hit.cellX == 4 && hit.cellY == 2 && near(hit.distance, 1.5f), "from inside a solid cell: " << hit.cellX);
+        const RayHit border = cast(room, 0.5f, 2.5f, -1.f, 0.f, 40.f);
+        CHECK(border.side == RayHit::NULLSIDE, "from inside the border, looking out of the map");
+    }
+
+    return testResult();
+}
@@ -0,0 +1,47 @@
+// GJSpritesTest.cpp : SpriteCuller's bins hold exactly the visible sprites covering a column of theirs, back to front.
+
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "GJSprites.h"
+#include "GJTest.h"
+
+int main() {
+    std::mt19937                          rng(99);
+    std::uniform_real_distribution<float> position(-20.f, 20.f);
+    std::uniform_real_distribution<float> size(0.1f, 3.f);
+    size_t                                binnedTotal = 0;
+
+    for (uint32_t binWidth : { 1U, 7U, 16U, 400U }) {
+        for (int frame = 0; frame < 50; ++frame) {
+            std::vector<Sprite> sprites(64);
+            for (Sprite& s : sprites) {
+                s = { position(rng), position(rng), size(rng), size(rng), 0 };
+            }
+            const SpriteView view = { 0.f, 0.f, 0.6f, 0.8f, 0.5f / 0.577f, 360, 0.1f, 40.f };
+
+            SpriteCuller culler;
+            culler.cull(sprites, view, binWidth);
+            const std::vector<ProjectedSprite>& visible = culler.getVisible();
+
+            for (uint32_t bin = 0; bin * binWidth < view.viewportWidth; ++bin) {
+                std::vector<uint32_t> expected;
+                for (uint32_t i = 0; i < visible.size(); ++i) {
+                    const SpriteColumns columns = SpriteCuller::getColumns(visible[i], view.viewportWidth);
+                    if (columns.begin < columns.end && columns.begin < (bin + 1) * binWidth && columns.end > bin * binWidth) {
+                        expected.push_back(i);
+                    }
+                }
+                const std::span<const uint32_t> binned = culler.getBin(bin);
+                binnedTotal += binned.size();
+                CHECK(std::vector<uint32_t>(binned.begin(), binned.end()) == expected,
+                      "bin " << bin << " of width " << binWidth << ": " << binned.size() << " vs " << expected.size());
+            }
+            CHECK(culler.getBin(view.viewportWidth).empty(), "bin past the viewport");
+        }
+    }
+    CHECK(binnedTotal > 0, "no sprite was visible");
+    return testResult();
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <iostream>
+
+// Minimal checks for the headless tests: a failed CHECK prints where and what, and the test returns testResult().
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition, ...)                                                                                          \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            ++testFailures();                                                                                          \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed. " << __VA_ARGS__ << '\n';     \
+        }                                                                                                              \
+    } while (false)
+
+/// \return main's exit code: 0 if every CHECK held
+inline int testResult() {
+    if (testFailures()) {
+        std::cerr << testFailures() << " checks failed\n";
+        return 1;
+    }
+    return 0;
+}
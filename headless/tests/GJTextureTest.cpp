@@ -0,0 +1,51 @@
+// GJTextureTest.cpp : CPUBitmap::generateMips weights the color of straight alpha texels by their alpha.
+
+#include <cstdint>
+#include <vector>
+
+#include "GJTest.h"
+#include "GJTexture.h"
+
+namespace {
+
+CPUBitmap make2x2(std::vector<uint32_t> texels) {
+    CPUBitmap bitmap = { .width = 2, .height = 2, .channels = 4 };
+    for (uint32_t texel : texels) {
+        for (uint32_t shift = 0; shift < 32; shift += 8) {
+            bitmap.data.push_back(uint8_t(texel >> shift));
+        }
+    }
+    return bitmap;
+}
+
+} // namespace
+
+int main() {
+    // a sprite's edge: one opaque red texel next to transparent ones, whose color is green
+    {
+        CPUBitmap edge = make2x2({ 0xFFFF0000, 0x0000FF00, 0x0000FF00, 0x0000FF00 });
+        edge.generateMips();
+        CHECK(edge.mips.size() == 2, "levels " << edge.mips.size());
+        CHECK(edge.texels(1)[0] == 0x40FF0000, "edge mip " << std::hex << edge.texels(1)[0]);
+    }
+
+    // half transparent texels weigh half
+    {
+        CPUBitmap half = make2x2({ 0xFFFF0000, 0x800000FF, 0xFFFF0000, 0x800000FF });
+        half.generateMips();
+        CHECK(half.texels(1)[0] == 0xC0AA0055, "half transparent mip " << std::hex << half.texels(1)[0]);
+    }
+
+    // opaque bitmaps average as before, fully transparent ones keep their plain average
+    {
+        CPUBitmap opaque = make2x2({ 0xFF000000, 0xFF040404, 0xFF080808, 0xFF0C0C0C });
+        opaque.generateMips();
+        CHECK(opaque.texels(1)[0] == 0xFF060606, "opaque mip " << std::hex << opaque.texels(1)[0]);
+
+        CPUBitmap transparent = make2x2({ 0x00000000, 0x00040404, 0x00080808, 0x000C0C0C });
+        transparent.generateMips();
+        CHECK(transparent.texels(1)[0] == 0x00060606, "transparent mip " << std::hex << transparent.texels(1)[0]);
+    }
+
+    return testResult();
+}